@@ -0,0 +1,220 @@
+// agenda.c
+// agenda de eventos no tempo simulado
+// simulador de computador
+// so24b
+
+#include "agenda.h"
+
+#include <stdlib.h>
+#include <limits.h>
+#include <assert.h>
+
+#define BITS_NIVEL 6                  // 64 posições por nível
+#define N_POSICOES (1 << BITS_NIVEL)
+#define N_NIVEIS   6                  // alcança 2^36 unidades de tempo
+
+struct agenda_t {
+  // instante atual
+  long agora;
+  // eventos de cada posição de cada nível, em listas duplamente encadeadas
+  // um evento do nível n tem as partes do instante (grupos de BITS_NIVEL
+  //   bits) acima da n iguais às do instante atual, e a parte n maior; os
+  //   eventos de um nível vencem todos depois dos dos níveis de baixo
+  evento_t *posicao[N_NIVEIS][N_POSICOES];
+  // próximo instante em que a agenda tem algo a fazer (um evento vence ou
+  //   os eventos de uma posição descem de nível); LONG_MAX se não tem evento
+  // pode ficar antes do necessário (depois de um cancelamento), nunca depois
+  long prox_mudanca;
+};
+
+agenda_t *agenda_cria(void)
+{
+  agenda_t *self = malloc(sizeof(*self));
+  assert(self != NULL);
+
+  self->agora = 0;
+  for (int nivel = 0; nivel < N_NIVEIS; nivel++) {
+    for (int pos = 0; pos < N_POSICOES; pos++) {
+      self->posicao[nivel][pos] = NULL;
+    }
+  }
+  self->prox_mudanca = LONG_MAX;
+
+  return self;
+}
+
+void agenda_destroi(agenda_t *self)
+{
+  free(self);
+}
+
+void evento_inicializa(evento_t *evento, f_evento_t funcao, void *arg)
+{
+  evento->funcao = funcao;
+  evento->arg = arg;
+  evento->quando = 0;
+  evento->programado = false;
+  evento->ant = NULL;
+  evento->prox = NULL;
+}
+
+bool evento_programado(evento_t *evento)
+{
+  return evento->programado;
+}
+
+// nível onde fica um evento que vence no instante 'quando': o da parte mais
+//   alta do instante que é diferente da do instante atual
+static int agenda__nivel(agenda_t *self, long quando)
+{
+  int nivel = N_NIVEIS - 1;
+  while (nivel > 0
+         && (quando >> (BITS_NIVEL * nivel)) == (self->agora >> (BITS_NIVEL * nivel))) {
+    nivel--;
+  }
+  return nivel;
+}
+
+// posição do instante 'quando' no nível
+static int agenda__posicao(long quando, int nivel)
+{
+  return (quando >> (BITS_NIVEL * nivel)) & (N_POSICOES - 1);
+}
+
+// instante em que o tempo chega ao trecho de uma posição do nível (no nível
+//   0, é o instante em que vencem os eventos da posição)
+static long agenda__inicio(agenda_t *self, int nivel, int pos)
+{
+  int bits = BITS_NIVEL * (nivel + 1);
+  return ((self->agora >> bits) << bits) | ((long)pos << (BITS_NIVEL * nivel));
+}
+
+static void agenda__insere(agenda_t *self, evento_t *evento)
+{
+  assert((evento->quando >> (BITS_NIVEL * N_NIVEIS))
+         == (self->agora >> (BITS_NIVEL * N_NIVEIS)));
+  int nivel = agenda__nivel(self, evento->quando);
+  int pos = agenda__posicao(evento->quando, nivel);
+  evento_t **lista = &self->posicao[nivel][pos];
+  evento->ant = NULL;
+  evento->prox = *lista;
+  if (*lista != NULL) (*lista)->ant = evento;
+  *lista = evento;
+  long inicio = agenda__inicio(self, nivel, pos);
+  if (inicio < self->prox_mudanca) self->prox_mudanca = inicio;
+}
+
+static void agenda__retira(agenda_t *self, evento_t *evento)
+{
+  if (evento->ant != NULL) {
+    evento->ant->prox = evento->prox;
+  } else {
+    int nivel = agenda__nivel(self, evento->quando);
+    self->posicao[nivel][agenda__posicao(evento->quando, nivel)] = evento->prox;
+  }
+  if (evento->prox != NULL) evento->prox->ant = evento->ant;
+  evento->ant = NULL;
+  evento->prox = NULL;
+}
+
+void agenda_programa(agenda_t *self, evento_t *evento, int atraso)
+{
+  assert(atraso > 0);
+  if (evento->programado) agenda__retira(self, evento);
+  evento->quando = self->agora + atraso;
+  evento->programado = true;
+  agenda__insere(self, evento);
+}
+
+void agenda_cancela(agenda_t *self, evento_t *evento)
+{
+  if (!evento->programado) return;
+  agenda__retira(self, evento);
+  evento->programado = false;
+}
+
+int agenda_tempo_ate(agenda_t *self, evento_t *evento)
+{
+  if (!evento->programado) return 0;
+  return evento->quando - self->agora;
+}
+
+// retorna a primeira posição com eventos (a dos que vencem primeiro), ou
+//   NULL se a agenda está vazia
+// as posições de um nível com eventos estão todas à frente do instante
+//   atual, e os níveis estão em ordem de instante
+static evento_t *agenda__primeira_posicao(agenda_t *self, int *pnivel, int *ppos)
+{
+  for (int nivel = 0; nivel < N_NIVEIS; nivel++) {
+    for (int pos = 0; pos < N_POSICOES; pos++) {
+      if (self->posicao[nivel][pos] != NULL) {
+        *pnivel = nivel;
+        *ppos = pos;
+        return self->posicao[nivel][pos];
+      }
+    }
+  }
+  return NULL;
+}
+
+int agenda_tempo_ate_proximo(agenda_t *self)
+{
+  int nivel, pos;
+  evento_t *evento = agenda__primeira_posicao(self, &nivel, &pos);
+  if (evento == NULL) return -1;
+  // fora do nível 0, os eventos da posição não vencem todos juntos
+  long quando = evento->quando;
+  for (; evento != NULL; evento = evento->prox) {
+    if (evento->quando < quando) quando = evento->quando;
+  }
+  return quando - self->agora;
+}
+
+// faz o que tem que ser feito no instante atual: desce de nível os eventos
+//   das posições cujo trecho começa agora (começando pelo nível mais alto,
+//   porque podem descer mais de um nível) e chama os que vencem agora
+static void agenda__processa(agenda_t *self)
+{
+  for (int nivel = N_NIVEIS - 1; nivel > 0; nivel--) {
+    if ((self->agora & ((1L << (BITS_NIVEL * nivel)) - 1)) != 0) continue;
+    int pos = agenda__posicao(self->agora, nivel);
+    evento_t *evento = self->posicao[nivel][pos];
+    self->posicao[nivel][pos] = NULL;
+    while (evento != NULL) {
+      evento_t *prox = evento->prox;
+      agenda__insere(self, evento);
+      evento = prox;
+    }
+  }
+  // a função pode mexer na agenda, pega um evento por vez
+  int pos = agenda__posicao(self->agora, 0);
+  evento_t *evento;
+  while ((evento = self->posicao[0][pos]) != NULL) {
+    agenda__retira(self, evento);
+    evento->programado = false;
+    evento->funcao(evento->arg);
+  }
+}
+
+// recalcula o próximo instante em que a agenda tem algo a fazer
+static void agenda__recalcula(agenda_t *self)
+{
+  int nivel, pos;
+  if (agenda__primeira_posicao(self, &nivel, &pos) == NULL) {
+    self->prox_mudanca = LONG_MAX;
+  } else {
+    self->prox_mudanca = agenda__inicio(self, nivel, pos);
+  }
+}
+
+void agenda_avanca(agenda_t *self, int n)
+{
+  long alvo = self->agora + n;
+  // nada muda nas posições entre uma mudança e outra, o tempo pode pular
+  while (self->prox_mudanca <= alvo) {
+    self->agora = self->prox_mudanca;
+    agenda__processa(self);
+    agenda__recalcula(self);
+  }
+  self->agora = alvo;
+}
@@ -0,0 +1,195 @@
+// bench_escalonador.c
+// mede o custo de uma decisão do escalonador por prioridade
+// simulador de computador
+// so24b
+
+// simula decisões do escalonador por prioridade com 'n' processos
+//   sintéticos, todos prontos: a cada decisão, o processo corrente tem a
+//   prioridade recalculada (como em calcula_prioridade no SO, com um tempo de
+//   uso do quantum aleatório), vai para o fim da fila e é escolhido o
+//   processo de menor valor de prioridade.
+// compara formas de manter a fila de prontos:
+//   - vetor reordenado por trocas a cada decisão, como o SO fazia, O(n²)
+//   - lista percorrida em busca do menor, O(n)
+//   - heap binário (fila_prio.h), em que só o processo corrente é
+//     reposicionado, O(log n): com a chave alterada no lugar
+//     (fila_prio_altera, como o SO faz em calcula_prioridade) ou com o
+//     processo removido e inserido de novo
+// o alvo bench_escalonador do Makefile compila com otimização e executa
+
+#include "fila_prio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define QUANTUM 10
+
+// para o compilador não descartar as escolhas
+static volatile int sumidouro;
+
+typedef struct {
+  int pid;
+  float prioridade;
+} proc_t;
+
+// nova prioridade do processo, que usou parte aleatória do quantum
+static float recalcula(float prioridade)
+{
+  int resto = rand() % (QUANTUM + 1);
+  return (prioridade + (QUANTUM - resto) / (float)QUANTUM) / 2;
+}
+
+// cria 'n' processos com prioridade inicial aleatória
+static proc_t *cria_procs(int n)
+{
+  proc_t *procs = malloc(n * sizeof(*procs));
+  for (int i = 0; i < n; i++) {
+    procs[i].pid = i;
+    procs[i].prioridade = (float)rand() / RAND_MAX;
+  }
+  return procs;
+}
+
+static double segundos(clock_t ini, clock_t fim)
+{
+  return (double)(fim - ini) / CLOCKS_PER_SEC;
+}
+
+// fila em vetor, ordenada por trocas a cada decisão; retorna o tempo em µs
+//   por decisão
+static double mede_ordenacao(int n, int n_decisoes)
+{
+  proc_t *procs = cria_procs(n);
+  proc_t **fila = malloc(n * sizeof(*fila));
+  for (int i = 0; i < n; i++) fila[i] = &procs[i];
+  clock_t ini = clock();
+  for (int d = 0; d < n_decisoes; d++) {
+    // o corrente (início da fila) vai para o fim
+    proc_t *corrente = fila[0];
+    corrente->prioridade = recalcula(corrente->prioridade);
+    for (int i = 1; i < n; i++) fila[i - 1] = fila[i];
+    fila[n - 1] = corrente;
+    for (int i = 0; i < n; i++) {
+      for (int j = i + 1; j < n; j++) {
+        if (fila[i]->prioridade > fila[j]->prioridade) {
+          proc_t *aux = fila[i];
+          fila[i] = fila[j];
+          fila[j] = aux;
+        }
+      }
+    }
+    sumidouro = fila[0]->pid;
+  }
+  clock_t fim = clock();
+  free(fila);
+  free(procs);
+  return segundos(ini, fim) * 1e6 / n_decisoes;
+}
+
+// fila em lista circular, percorrida em busca do menor a cada decisão
+static double mede_busca(int n, int n_decisoes)
+{
+  proc_t *procs = cria_procs(n);
+  int *prox = malloc(n * sizeof(*prox));
+  int *ant = malloc(n * sizeof(*ant));
+  for (int i = 0; i < n; i++) {
+    prox[i] = (i + 1) % n;
+    ant[i] = (i + n - 1) % n;
+  }
+  int ini_fila = 0;
+  int corrente = 0;
+  clock_t ini = clock();
+  for (int d = 0; d < n_decisoes; d++) {
+    procs[corrente].prioridade = recalcula(procs[corrente].prioridade);
+    // o corrente vai para o fim da fila (antes do início, na lista circular)
+    if (corrente == ini_fila) {
+      ini_fila = prox[corrente];
+    } else {
+      prox[ant[corrente]] = prox[corrente];
+      ant[prox[corrente]] = ant[corrente];
+      prox[corrente] = ini_fila;
+      ant[corrente] = ant[ini_fila];
+      prox[ant[ini_fila]] = corrente;
+      ant[ini_fila] = corrente;
+    }
+    int melhor = ini_fila;
+    for (int p = prox[ini_fila]; p != ini_fila; p = prox[p]) {
+      if (procs[p].prioridade < procs[melhor].prioridade) melhor = p;
+    }
+    corrente = melhor;
+    sumidouro = corrente;
+  }
+  clock_t fim = clock();
+  free(prox);
+  free(ant);
+  free(procs);
+  return segundos(ini, fim) * 1e6 / n_decisoes;
+}
+
+// fila de prioridade em heap, com a chave do corrente alterada no lugar
+static double mede_heap_altera(int n, int n_decisoes)
+{
+  proc_t *procs = cria_procs(n);
+  fila_prio_t *fila = fila_prio_cria();
+  for (int i = 0; i < n; i++) {
+    fila_prio_insere(fila, procs[i].pid, procs[i].prioridade);
+  }
+  int corrente = fila_prio_primeiro(fila);
+  clock_t ini = clock();
+  for (int d = 0; d < n_decisoes; d++) {
+    procs[corrente].prioridade = recalcula(procs[corrente].prioridade);
+    fila_prio_altera(fila, corrente, procs[corrente].prioridade);
+    corrente = fila_prio_primeiro(fila);
+    sumidouro = corrente;
+  }
+  clock_t fim = clock();
+  fila_prio_destroi(fila);
+  free(procs);
+  return segundos(ini, fim) * 1e6 / n_decisoes;
+}
+
+// fila de prioridade em heap, com o corrente removido e inserido de novo
+static double mede_heap_reinsere(int n, int n_decisoes)
+{
+  proc_t *procs = cria_procs(n);
+  fila_prio_t *fila = fila_prio_cria();
+  for (int i = 0; i < n; i++) {
+    fila_prio_insere(fila, procs[i].pid, procs[i].prioridade);
+  }
+  int corrente = fila_prio_primeiro(fila);
+  clock_t ini = clock();
+  for (int d = 0; d < n_decisoes; d++) {
+    procs[corrente].prioridade = recalcula(procs[corrente].prioridade);
+    // vai para o fim da fila: perde a antiguidade no desempate
+    fila_prio_remove(fila, corrente);
+    fila_prio_insere(fila, corrente, procs[corrente].prioridade);
+    corrente = fila_prio_primeiro(fila);
+    sumidouro = corrente;
+  }
+  clock_t fim = clock();
+  fila_prio_destroi(fila);
+  free(procs);
+  return segundos(ini, fim) * 1e6 / n_decisoes;
+}
+
+int main(void)
+{
+  int tamanhos[] = { 1000, 2000, 5000, 10000 };
+  int n_tamanhos = sizeof(tamanhos) / sizeof(tamanhos[0]);
+
+  srand(42);
+  printf("%8s %16s %16s %19s %19s\n", "processos", "ordenação (µs)",
+         "busca (µs)", "heap altera (µs)", "heap reinsere (µs)");
+  for (int i = 0; i < n_tamanhos; i++) {
+    int n = tamanhos[i];
+    // número de decisões de cada medida, para levar um tempo razoável
+    double ordenacao = mede_ordenacao(n, 200000000 / n / n + 1);
+    double busca = mede_busca(n, 200000000 / n);
+    double altera = mede_heap_altera(n, 2000000);
+    double reinsere = mede_heap_reinsere(n, 2000000);
+    printf("%9d %15.2f %15.3f %18.4f %18.4f\n", n, ordenacao, busca, altera,
+           reinsere);
+  }
+  return 0;
+}
@@ -12,14 +12,35 @@
 typedef struct console_t console_t;
 
 // cria e inicializa a console
-console_t *console_cria(void);
+// se 'usa_tela' for false, a console não usa o terminal físico (modo lote):
+//   não desenha nada nem lê o teclado do operador, a saída de cada terminal
+//   é copiada para o arquivo "log_do_terminal_X" e a entrada pode vir de um
+//   arquivo (ver console_define_entrada)
+console_t *console_cria(bool usa_tela);
 
 // destrói a console
 void console_destroi(console_t *self);
 
-// imprime na área geral do console
+// nível de detalhe das mensagens na console
+typedef enum {
+  MSG_ERRO,     // problemas
+  MSG_INFO,     // acontecimentos importantes (o default de console_printf)
+  MSG_DETALHE,  // acontecimentos frequentes (cada interrupção, cada chamada)
+} nivel_msg_t;
+
+// imprime na área geral do console (e no arquivo "log_da_console"), com
+//   nível MSG_INFO
 int console_printf(char *fmt, ...);
 
+// imprime na área geral do console, se o nível da mensagem não estiver
+//   acima do definido com console_define_nivel; se estiver, a mensagem nem
+//   é formatada (é barato chamar com mensagens que não serão mostradas)
+int console_log(nivel_msg_t nivel, char *fmt, ...);
+
+// define o nível das mensagens mostradas na console (o default é
+//   MSG_DETALHE, todas)
+void console_define_nivel(console_t *self, nivel_msg_t nivel);
+
 // imprime na linha de status
 void console_print_status(console_t *self, char *txt);
 
@@ -34,10 +55,49 @@ void console_print_status(console_t *self, char *txt);
 // retorna '\0' caso não tenha comando externo digitado
 char console_comando_externo(console_t *self);
 
+// espera até 'ms' milissegundos que o operador digite alguma coisa
+// é para quem não tem o que fazer enquanto isso (a simulação está parada),
+//   em vez de ficar chamando a console sem parar
+void console_espera_entrada(console_t *self, int ms);
+
+// espera o tempo por instrução pedido pelo operador com o comando D (nenhum,
+//   por padrão), ou até ele digitar alguma coisa
+// é para ser chamada a cada instrução executada, para a execução poder ser
+//   vista devagar
+void console_espera_instrucao(console_t *self);
+
 // retorna o terminal identificado ('A', 'B', etc)
 terminal_t *console_terminal(console_t *self, char id_terminal);
 
-// esta função deve ser chamada periodicamente para que tela funcione
-void console_tictac(console_t *self);
+// define um arquivo de onde serão lidos os caracteres digitados no terminal
+//   identificado, à medida que couberem na entrada do terminal
+// retorna false se o terminal ou o arquivo forem inválidos
+bool console_define_entrada(console_t *self, char id_terminal, char *nome_arquivo);
+
+// estas funções devem ser chamadas periodicamente para que a tela funcione,
+//   em ritmos diferentes:
+// avança o estado dos terminais (e a entrada vinda de arquivo) -- é barata,
+//   pode ser chamada a cada instrução
+void console_tictac_terminais(console_t *self);
+// lê o teclado do operador e redesenha a tela -- é cara, mas só as linhas
+//   que mudaram desde o desenho anterior são redesenhadas
+void console_atualiza_tela(console_t *self);
+
+// retorna true se já é hora de redesenhar a tela, que não precisa ser
+//   redesenhada mais que umas 30 vezes por segundo (false se não tem tela)
+// é para quem chama console_atualiza_tela a cada instrução, e para quem tem
+//   que preparar alguma coisa para o desenho (como o texto de status) e não
+//   quer fazer isso à toa
+bool console_hora_de_desenhar(console_t *self);
+
+// retorna em quantas chamadas a console_tictac_terminais algum terminal muda
+//   de estado sozinho (um passo da rolagem ou da limpeza da saída, ou a
+//   chegada de entrada do arquivo), ou -1 se nenhum vai mudar sem ação da
+//   CPU ou do operador
+int console_tempo_ate_evento(console_t *self);
+
+// avança o estado dos terminais como 'n' chamadas a console_tictac_terminais,
+//   sem o custo de fazer uma por uma
+void console_avanca_terminais(console_t *self, int n);
 
 #endif // CONSOLE_H
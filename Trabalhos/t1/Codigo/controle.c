@@ -6,23 +6,41 @@
 #include "controle.h"
 
 #include <stdlib.h>
+#include <stdbool.h>
 #include <string.h>
 #include <stdio.h>
 #include <assert.h>
+#include <limits.h>
+
+// quanto tempo esperar pelo operador a cada volta do laço quando a execução
+//   está parada, em ms
+#define ESPERA_PARADO 20
 
 struct controle_t {
   cpu_t *cpu;
   relogio_t *relogio;
+  // eventos dos dispositivos, que avançam junto com o relógio
+  agenda_t *agenda;
   console_t *console;
+  pic_t *pic;
   enum { executando, passo, parado, fim } estado;
+  // modo lote (ver controle_define_lote)
+  bool lote;
+  int intervalo_console;
+  long max_instrucoes;
 };
 
 // funções auxiliares
+static void controle_executa_instrucao(controle_t *self);
+static bool controle_cpu_inativa(controle_t *self);
+static int controle_pula_ociosidade(controle_t *self, int max_pulo);
+static void controle_laco_lote(controle_t *self);
 static void controle_processa_comandos_da_console(controle_t *self);
 static void controle_atualiza_estado_na_console(controle_t *self);
 
 
-controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio)
+controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio,
+                          agenda_t *agenda, pic_t *pic)
 {
   controle_t *self = malloc(sizeof(*self));
   assert(self != NULL);
@@ -30,7 +48,10 @@ controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio)
   self->cpu = cpu;
   self->console = console;
   self->relogio = relogio;
+  self->agenda = agenda;
+  self->pic = pic;
   self->estado = parado;
+  self->lote = false;
 
   return self;
 }
@@ -40,34 +61,150 @@ void controle_destroi(controle_t *self)
   free(self);
 }
 
-void controle_laco(controle_t *self)
+void controle_define_lote(controle_t *self, int intervalo_console,
+                          long max_instrucoes)
 {
-  // executa uma instrução por vez até a console dizer que chega
-  do {
-    if (self->estado == passo || self->estado == executando) {
-      cpu_executa_1(self->cpu);
-      relogio_tictac(self->relogio);
-
-      if (self->estado == passo) self->estado = parado;
+  self->lote = true;
+  self->intervalo_console = intervalo_console;
+  self->max_instrucoes = max_instrucoes;
+}
 
-      // enquanto não tem controlador de interrupção, fala direto com o relógio
-      // o dispositivo 3 do relógio contém 1 se o timer expirou
-      int tem_int;
-      relogio_leitura(self->relogio, 3, &tem_int);
-      if (tem_int != 0) {
-        cpu_interrompe(self->cpu, IRQ_RELOGIO);
+void controle_laco(controle_t *self)
+{
+  if (self->lote) {
+    controle_laco_lote(self);
+  } else {
+    // executa uma instrução por vez até a console dizer que chega
+    do {
+      if (self->estado == executando) controle_pula_ociosidade(self, INT_MAX);
+      if (self->estado == passo || self->estado == executando) {
+        controle_executa_instrucao(self);
+        console_espera_instrucao(self->console);
+
+        if (self->estado == passo) self->estado = parado;
+      } else {
+        // não tem o que fazer até o operador mandar
+        console_espera_entrada(self->console, ESPERA_PARADO);
       }
-    }
-    console_tictac(self->console);
-
-    controle_processa_comandos_da_console(self);
+      console_tictac_terminais(self->console);
+
+      controle_processa_comandos_da_console(self);
+      // a tela só é redesenhada algumas vezes por segundo; o status só é
+      //   montado quando vai ser mostrado
+      if (console_hora_de_desenhar(self->console)) {
+        controle_atualiza_estado_na_console(self);
+        console_atualiza_tela(self->console);
+      }
+    } while (self->estado != fim);
+    // para o último desenho da tela
     controle_atualiza_estado_na_console(self);
-  } while (self->estado != fim);
+  }
 
   console_printf("Fim da execução.");
   console_printf("relógio: %d\n", relogio_agora(self->relogio));
 }
- 
+
+// executa uma instrução, avança o relógio e verifica interrupções
+static void controle_executa_instrucao(controle_t *self)
+{
+  cpu_executa_1(self->cpu);
+  relogio_tictac(self->relogio);
+  // os dispositivos só fazem alguma coisa se tiver evento vencendo
+  agenda_avanca(self->agenda, 1);
+
+  // repassa para a CPU a interrupção mais prioritária pedida pelos
+  //   dispositivos; se a CPU não aceitar, ela continua pendente
+  irq_t irq;
+  if (pic_proxima(self->pic, &irq)) {
+    cpu_interrompe(self->cpu, irq);
+  }
+}
+
+// retorna true se a CPU está parada e nada mais pode acordá-la
+// (nenhuma interrupção pendente, e nenhum evento na agenda -- os terminais,
+//   que têm agenda própria, não pedem interrupção sem ação da CPU que já não
+//   esteja pendente)
+static bool controle_cpu_inativa(controle_t *self)
+{
+  if (!cpu_parada(self->cpu)) return false;
+  irq_t irq;
+  if (pic_proxima(self->pic, &irq)) return false;
+  return agenda_tempo_ate_proximo(self->agenda) < 0;
+}
+
+// se a CPU está parada esperando interrupção, avança o tempo de uma vez até
+//   logo antes do próximo evento que pode acordá-la (um evento da agenda,
+//   como o fim da contagem do relógio, ou um terminal que fica pronto), em
+//   vez de uma unidade por volta do laço, sem mudar o resultado da simulação
+// pula no máximo 'max_pulo' unidades de tempo; retorna quantas pulou
+static int controle_pula_ociosidade(controle_t *self, int max_pulo)
+{
+  if (!cpu_parada(self->cpu)) return 0;
+  irq_t irq;
+  if (pic_proxima(self->pic, &irq)) return 0;
+
+  // em quantas voltas do laço alguma interrupção pode ser pedida
+  int t_evento = agenda_tempo_ate_proximo(self->agenda);
+  if (t_evento < 0) t_evento = INT_MAX;
+  // a mudança nos terminais só é vista pelo controlador na volta seguinte
+  int t_terminais = console_tempo_ate_evento(self->console);
+  if (t_terminais > 0 && t_terminais + 1 < t_evento) t_evento = t_terminais + 1;
+  // sem evento previsto, só o operador pode acordar a CPU
+  if (t_evento == INT_MAX) return 0;
+
+  // a volta do evento é executada normalmente
+  int pulo = t_evento - 1;
+  if (pulo > max_pulo) pulo = max_pulo;
+  if (pulo <= 0) return 0;
+  cpu_dorme(self->cpu, pulo);
+  relogio_avanca(self->relogio, pulo);
+  agenda_avanca(self->agenda, pulo);
+  console_avanca_terminais(self->console, pulo);
+  return pulo;
+}
+
+// laço do modo lote: executa sem a console a cada instrução
+static void controle_laco_lote(controle_t *self)
+{
+  long n_instrucoes = 0;
+  long prox_console = self->intervalo_console;
+  self->estado = executando;
+  do {
+    if (self->estado == executando) {
+      // o tempo pulado conta como instruções (ociosas) executadas, e não
+      //   passa do limite
+      int max_pulo = INT_MAX;
+      if (self->max_instrucoes > 0 && self->max_instrucoes - n_instrucoes - 1 < max_pulo) {
+        max_pulo = self->max_instrucoes - n_instrucoes - 1;
+      }
+      n_instrucoes += controle_pula_ociosidade(self, max_pulo);
+    }
+    if (self->estado == executando || self->estado == passo) {
+      controle_executa_instrucao(self);
+      n_instrucoes++;
+      if (self->estado == passo) self->estado = parado;
+      if (controle_cpu_inativa(self)) self->estado = fim;
+      if (self->max_instrucoes > 0 && n_instrucoes >= self->max_instrucoes) {
+        self->estado = fim;
+      }
+    }
+    console_tictac_terminais(self->console);
+
+    // a console só é atendida de vez em quando (ou sempre, se estiver parado,
+    //   porque aí não tem o que executar)
+    if (self->intervalo_console > 0
+        && (self->estado == parado || n_instrucoes >= prox_console)) {
+      prox_console = n_instrucoes + self->intervalo_console;
+      if (self->estado == parado) {
+        console_espera_entrada(self->console, ESPERA_PARADO);
+      }
+      console_atualiza_tela(self->console);
+      controle_processa_comandos_da_console(self);
+      controle_atualiza_estado_na_console(self);
+    }
+  } while (self->estado != fim);
+}
+
 
 static void controle_processa_comandos_da_console(controle_t *self)
 {
@@ -11,11 +11,29 @@ typedef struct controle_t controle_t;
 #include "cpu.h"
 #include "console.h"
 #include "relogio.h"
+#include "agenda.h"
+#include "pic.h"
 
-controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio);
+// cria o controle, que executa instruções na CPU, faz o tempo passar no
+//   relógio e na agenda dos eventos dos dispositivos, e repassa à CPU as
+//   interrupções do controlador 'pic'
+controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio,
+                          agenda_t *agenda, pic_t *pic);
 void controle_destroi(controle_t *self);
 
+// coloca o controle em modo lote: a execução começa sem esperar comando do
+//   operador, e termina sozinha quando a CPU estiver parada sem ter como ser
+//   interrompida (relógio desligado), ou após 'max_instrucoes' instruções
+//   (0 para não ter limite)
+// a console (leitura de comandos e desenho da tela) só é atualizada a cada
+//   'intervalo_console' instruções (0 para nunca); os terminais continuam
+//   sendo atualizados a cada instrução
+void controle_define_lote(controle_t *self, int intervalo_console,
+                          long max_instrucoes);
+
 // o laço principal da simulação
+// enquanto a CPU está parada esperando interrupção, o tempo até o próximo
+//   evento da agenda (ou dos terminais) é avançado de uma vez
 void controle_laco(controle_t *self);
 
 #endif // CONTROLE_H
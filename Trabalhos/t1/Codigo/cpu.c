@@ -33,6 +33,8 @@ struct cpu_t {
   // função e argumento para implementar instrução CHAMAC
   func_chamaC_t funcaoC;
   void *argC;
+  // ciclos que a CPU ainda vai passar ocupada sem executar (ver cpu_ocupa)
+  int ciclos_ocupada;
 };
 
 // CRIAÇÃO {{{1
@@ -52,6 +54,7 @@ cpu_t *cpu_cria(mem_t *mem, es_t *es)
   self->complemento = 0;
   self->modo = usuario;
   self->funcaoC = NULL;
+  self->ciclos_ocupada = 0;
   // inicializa instruções privilegiadas
   memset(self->privilegiadas, 0, sizeof(self->privilegiadas));
   self->privilegiadas[PARA] = true;
@@ -77,6 +80,23 @@ void cpu_define_chamaC(cpu_t *self, func_chamaC_t funcaoC, void *argC)
   self->argC = argC;
 }
 
+bool cpu_parada(cpu_t *self)
+{
+  return self->erro == ERR_CPU_PARADA;
+}
+
+void cpu_ocupa(cpu_t *self, int ciclos)
+{
+  if (ciclos > 0) self->ciclos_ocupada += ciclos;
+}
+
+void cpu_dorme(cpu_t *self, int ciclos)
+{
+  assert(cpu_parada(self));
+  if (ciclos > self->ciclos_ocupada) ciclos = self->ciclos_ocupada;
+  self->ciclos_ocupada -= ciclos;
+}
+
 // IMPRESSÃO {{{1
 static void imprime_registradores(cpu_t *self, char *str)
 {
@@ -465,6 +485,12 @@ static void executa_a_instrucao(cpu_t *self, int opcode)
 
 void cpu_executa_1(cpu_t *self)
 {
+  // o tempo deste ciclo foi gasto em alguma operação do SO (ver cpu_ocupa)
+  if (self->ciclos_ocupada > 0) {
+    self->ciclos_ocupada--;
+    return;
+  }
+
   // não executa se CPU já estiver em erro
   if (self->erro != ERR_OK) return;
 
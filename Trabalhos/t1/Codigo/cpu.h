@@ -44,6 +44,19 @@ bool cpu_interrompe(cpu_t *self, irq_t irq);
 // e o argumento a passar para ela (normalmente, um ponteiro para o SO)
 void cpu_define_chamaC(cpu_t *self, func_chamaC_t func, void *argC);
 
+// retorna true se a CPU está parada (executou PARA), esperando uma interrupção
+bool cpu_parada(cpu_t *self);
+
+// ocupa a CPU por 'ciclos' execuções de cpu_executa_1, sem executar instruções
+// serve para o SO simular o custo de operações que o tratador de interrupção
+//   não executa instrução a instrução, como a troca de contexto
+void cpu_ocupa(cpu_t *self, int ciclos);
+
+// equivale a 'ciclos' execuções de cpu_executa_1 com a CPU parada (só
+//   consome o tempo em que ela estaria ocupada)
+// usada pelo controle para avançar de uma vez o tempo em que a CPU dorme
+void cpu_dorme(cpu_t *self, int ciclos);
+
 // concatena a descrição do estado da CPU no final de str
 void cpu_concatena_descricao(cpu_t *self, char *str);
 
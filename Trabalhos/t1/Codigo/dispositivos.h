@@ -27,6 +27,16 @@ typedef enum {
   D_RELOGIO_REAL          = 17,
   D_RELOGIO_TIMER         = 18,
   D_RELOGIO_INTERRUPCAO   = 19,
+  D_TERM_A_TECLADO_INT    = 20,
+  D_TERM_A_TELA_INT       = 21,
+  D_TERM_B_TECLADO_INT    = 22,
+  D_TERM_B_TELA_INT       = 23,
+  D_TERM_C_TECLADO_INT    = 24,
+  D_TERM_C_TELA_INT       = 25,
+  D_TERM_D_TECLADO_INT    = 26,
+  D_TERM_D_TELA_INT       = 27,
+  D_PIC_PENDENTES         = 28,
+  D_PIC_MASCARA           = 29,
   N_DISPOSITIVOS
 } dispositivo_id_t;
 
@@ -40,4 +50,9 @@ typedef enum {
 #define TERMINAL_C 8
 #define TERMINAL_D 12
 
+// dispositivos de interrupção do terminal (TERMINAL_A etc); ficam depois dos
+//   outros para não mudar a numeração usada pelos programas
+#define TECLADO_INT(terminal) (D_TERM_A_TECLADO_INT + (terminal) / 2)
+#define TELA_INT(terminal)    (D_TERM_A_TELA_INT + (terminal) / 2)
+
 #endif // DISPOSITIVOS_H
@@ -0,0 +1,173 @@
+// fila_prio.c
+// fila de prioridade (heap binário)
+// simulador de computador
+// so24b
+
+#include "fila_prio.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+// um elemento do heap
+typedef struct {
+  int id;
+  float chave;
+  // ordem de inserção, para desempate entre chaves iguais
+  long ordem;
+} elemento_t;
+
+struct fila_prio_t {
+  // heap binário: os filhos do elemento 'i' estão em '2i+1' e '2i+2'
+  elemento_t *heap;
+  int tam;
+  int cap;
+  // posição de cada identificador no heap (-1 se não estiver na fila)
+  int *pos;
+  int n_pos;
+  // contador para a ordem de inserção
+  long n_insercoes;
+};
+
+fila_prio_t *fila_prio_cria(void)
+{
+  fila_prio_t *self = malloc(sizeof(*self));
+  assert(self != NULL);
+
+  self->tam = 0;
+  self->cap = 16;
+  self->heap = malloc(self->cap * sizeof(*self->heap));
+  assert(self->heap != NULL);
+  self->n_pos = 0;
+  self->pos = NULL;
+  self->n_insercoes = 0;
+
+  return self;
+}
+
+void fila_prio_destroi(fila_prio_t *self)
+{
+  free(self->heap);
+  free(self->pos);
+  free(self);
+}
+
+// aumenta a tabela de posições para conter o identificador 'id'
+static void fila_prio__cabe_id(fila_prio_t *self, int id)
+{
+  if (id < self->n_pos) return;
+  int n_pos = self->n_pos == 0 ? 16 : self->n_pos;
+  while (n_pos <= id) n_pos *= 2;
+  self->pos = realloc(self->pos, n_pos * sizeof(*self->pos));
+  assert(self->pos != NULL);
+  for (int i = self->n_pos; i < n_pos; i++) {
+    self->pos[i] = -1;
+  }
+  self->n_pos = n_pos;
+}
+
+// retorna true se o elemento 'a' deve vir antes do 'b'
+static bool fila_prio__antes(elemento_t *a, elemento_t *b)
+{
+  if (a->chave != b->chave) return a->chave < b->chave;
+  return a->ordem < b->ordem;
+}
+
+// coloca o elemento na posição 'i' do heap, atualizando a sua posição
+static void fila_prio__coloca(fila_prio_t *self, int i, elemento_t elemento)
+{
+  self->heap[i] = elemento;
+  self->pos[elemento.id] = i;
+}
+
+// sobe o elemento da posição 'i' enquanto ele deve vir antes do pai
+static void fila_prio__sobe(fila_prio_t *self, int i)
+{
+  elemento_t elemento = self->heap[i];
+  while (i > 0) {
+    int pai = (i - 1) / 2;
+    if (!fila_prio__antes(&elemento, &self->heap[pai])) break;
+    fila_prio__coloca(self, i, self->heap[pai]);
+    i = pai;
+  }
+  fila_prio__coloca(self, i, elemento);
+}
+
+// desce o elemento da posição 'i' enquanto algum filho deve vir antes dele
+static void fila_prio__desce(fila_prio_t *self, int i)
+{
+  elemento_t elemento = self->heap[i];
+  for (;;) {
+    int filho = 2 * i + 1;
+    if (filho >= self->tam) break;
+    if (filho + 1 < self->tam
+        && fila_prio__antes(&self->heap[filho + 1], &self->heap[filho])) {
+      filho++;
+    }
+    if (!fila_prio__antes(&self->heap[filho], &elemento)) break;
+    fila_prio__coloca(self, i, self->heap[filho]);
+    i = filho;
+  }
+  fila_prio__coloca(self, i, elemento);
+}
+
+// recoloca em ordem o elemento da posição 'i', que teve a chave alterada
+static void fila_prio__ajusta(fila_prio_t *self, int i)
+{
+  if (i > 0 && fila_prio__antes(&self->heap[i], &self->heap[(i - 1) / 2])) {
+    fila_prio__sobe(self, i);
+  } else {
+    fila_prio__desce(self, i);
+  }
+}
+
+void fila_prio_insere(fila_prio_t *self, int id, float chave)
+{
+  assert(id >= 0);
+  if (fila_prio_contem(self, id)) return;
+  fila_prio__cabe_id(self, id);
+  if (self->tam == self->cap) {
+    self->cap *= 2;
+    self->heap = realloc(self->heap, self->cap * sizeof(*self->heap));
+    assert(self->heap != NULL);
+  }
+  elemento_t elemento = { id, chave, self->n_insercoes++ };
+  fila_prio__coloca(self, self->tam, elemento);
+  self->tam++;
+  fila_prio__sobe(self, self->tam - 1);
+}
+
+void fila_prio_remove(fila_prio_t *self, int id)
+{
+  if (!fila_prio_contem(self, id)) return;
+  int i = self->pos[id];
+  self->pos[id] = -1;
+  self->tam--;
+  if (i == self->tam) return;
+  // o último elemento ocupa o lugar do removido
+  fila_prio__coloca(self, i, self->heap[self->tam]);
+  fila_prio__ajusta(self, i);
+}
+
+void fila_prio_altera(fila_prio_t *self, int id, float chave)
+{
+  if (!fila_prio_contem(self, id)) return;
+  int i = self->pos[id];
+  self->heap[i].chave = chave;
+  fila_prio__ajusta(self, i);
+}
+
+bool fila_prio_contem(fila_prio_t *self, int id)
+{
+  return id >= 0 && id < self->n_pos && self->pos[id] != -1;
+}
+
+int fila_prio_primeiro(fila_prio_t *self)
+{
+  if (self->tam == 0) return -1;
+  return self->heap[0].id;
+}
+
+int fila_prio_tam(fila_prio_t *self)
+{
+  return self->tam;
+}
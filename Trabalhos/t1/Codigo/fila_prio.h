@@ -0,0 +1,56 @@
+// fila_prio.h
+// fila de prioridade (heap binário)
+// simulador de computador
+// so24b
+
+#ifndef FILA_PRIO_H
+#define FILA_PRIO_H
+
+// fila de prioridade de identificadores inteiros (não negativos), ordenada
+//   por uma chave: o primeiro da fila é o de menor chave. entre
+//   identificadores de mesma chave, o que foi inserido antes é o primeiro.
+//
+// é implementada com um heap binário, e guarda a posição de cada
+//   identificador no heap, para que a chave de qualquer um possa ser
+//   alterada (ou ele possa ser removido) sem percorrer a fila.
+// inserção, remoção e alteração de chave são O(log n), consulta ao
+//   primeiro e ao tamanho são O(1).
+//
+// o SO usa para a fila de prontos dos escalonadores por prioridade e de
+//   múltiplas filas, com a posição do processo na tabela de processos como
+//   identificador e a prioridade (ou o nível) do processo como chave.
+
+#include <stdbool.h>
+
+typedef struct fila_prio_t fila_prio_t;
+
+// cria uma fila de prioridade vazia
+fila_prio_t *fila_prio_cria(void);
+
+// destrói uma fila de prioridade
+void fila_prio_destroi(fila_prio_t *self);
+
+// insere o identificador 'id' com a chave 'chave'
+// não faz nada se o identificador já está na fila
+void fila_prio_insere(fila_prio_t *self, int id, float chave);
+
+// remove o identificador 'id' da fila
+// não faz nada se o identificador não está na fila
+void fila_prio_remove(fila_prio_t *self, int id);
+
+// altera a chave do identificador 'id' (aumenta ou diminui), mantendo sua
+//   ordem de inserção para o desempate
+// não faz nada se o identificador não está na fila
+void fila_prio_altera(fila_prio_t *self, int id, float chave);
+
+// retorna true se o identificador 'id' está na fila
+bool fila_prio_contem(fila_prio_t *self, int id);
+
+// retorna o identificador de menor chave, sem removê-lo, ou -1 se a fila
+//   estiver vazia
+int fila_prio_primeiro(fila_prio_t *self);
+
+// retorna o número de identificadores na fila
+int fila_prio_tam(fila_prio_t *self);
+
+#endif // FILA_PRIO_H
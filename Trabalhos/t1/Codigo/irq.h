@@ -14,9 +14,8 @@ typedef enum {
   IRQ_SISTEMA,       // chamada de sistema
   // interrupções geradas por dispositivos de E/S
   IRQ_RELOGIO,       // interrupção causada pelo relógio
-  // interrupções de E/S ainda não implementadas
-  IRQ_TECLADO,       // interrupção causada pelo teclado
-  IRQ_TELA,          // interrupção causada pela tela
+  IRQ_TECLADO,       // algum teclado tem caractere para ler
+  IRQ_TELA,          // alguma tela pode receber caractere
   N_IRQ              // número de interrupções
 } irq_t;
 
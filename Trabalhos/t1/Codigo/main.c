@@ -7,6 +7,8 @@
 #include "memoria.h"
 #include "cpu.h"
 #include "relogio.h"
+#include "agenda.h"
+#include "pic.h"
 #include "console.h"
 #include "terminal.h"
 #include "es.h"
@@ -15,6 +17,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
 
 // constantes
 #define MEM_TAM 10000        // tamanho da memória principal
@@ -24,61 +28,104 @@ typedef struct {
   mem_t *mem;
   cpu_t *cpu;
   relogio_t *relogio;
+  agenda_t *agenda;
+  pic_t *pic;
   console_t *console;
   es_t *es;
   controle_t *controle;
 } hardware_t;
 
-static void cria_hardware(hardware_t *hw)
+// opções da linha de comando
+typedef struct {
+  // modo lote (ver controle_define_lote)
+  bool lote;
+  int intervalo_console;
+  long max_instrucoes;
+  // nível das mensagens na console
+  nivel_msg_t nivel_console;
+  // arquivos com a entrada de cada terminal (NULL se não tiver)
+  char *entrada[4];
+  // parâmetros do SO
+  so_config_t so;
+} opcoes_t;
+
+static void cria_hardware(hardware_t *hw, bool usa_tela)
 {
   // cria a memória
   hw->mem = mem_cria(MEM_TAM);
 
   // cria dispositivos de E/S
-  hw->console = console_cria();
-  hw->relogio = relogio_cria();
+  hw->console = console_cria(usa_tela);
+  hw->agenda = agenda_cria();
+  hw->relogio = relogio_cria(hw->agenda);
+
+  // cria o controlador de interrupções e liga os dispositivos a ele
+  // o relógio tem prioridade sobre os outros, para não atrasar a preempção
+  hw->pic = pic_cria();
+  pic_define_prioridade(hw->pic, IRQ_RELOGIO, 1);
+  relogio_define_pic(hw->relogio, hw->pic, IRQ_RELOGIO);
+  for (char t = 'A'; t <= 'D'; t++) {
+    terminal_define_pic(console_terminal(hw->console, t), hw->pic,
+                        IRQ_TECLADO, IRQ_TELA);
+  }
 
   // cria o controlador de E/S e registra os dispositivos
   //   por exemplo, o dispositivo 8 do controlador de E/S (e da CPU) será o
   //   dispositivo 0 do relógio (que é o contador de instruções)
   hw->es = es_cria();
-  // lê teclado, testa teclado, escreve tela, testa tela do terminal A
+  // lê teclado, testa teclado, escreve tela, testa tela e interrupções do
+  //   terminal A
   terminal_t *terminal;
   terminal = console_terminal(hw->console, 'A');
   es_registra_dispositivo(hw->es, D_TERM_A_TECLADO    , terminal, 0, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_A_TECLADO_OK , terminal, 1, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_A_TELA       , terminal, 2, NULL, terminal_escrita);
   es_registra_dispositivo(hw->es, D_TERM_A_TELA_OK    , terminal, 3, terminal_leitura, NULL);
-  // lê teclado, testa teclado, escreve tela, testa tela do terminal B
+  es_registra_dispositivo(hw->es, D_TERM_A_TECLADO_INT, terminal, 4, terminal_leitura, terminal_escrita);
+  es_registra_dispositivo(hw->es, D_TERM_A_TELA_INT   , terminal, 5, terminal_leitura, terminal_escrita);
+  // lê teclado, testa teclado, escreve tela, testa tela e interrupções do
+  //   terminal B
   terminal = console_terminal(hw->console, 'B');
   es_registra_dispositivo(hw->es, D_TERM_B_TECLADO    , terminal, 0, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_B_TECLADO_OK , terminal, 1, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_B_TELA       , terminal, 2, NULL, terminal_escrita);
   es_registra_dispositivo(hw->es, D_TERM_B_TELA_OK    , terminal, 3, terminal_leitura, NULL);
-  // lê teclado, testa teclado, escreve tela, testa tela do terminal C
+  es_registra_dispositivo(hw->es, D_TERM_B_TECLADO_INT, terminal, 4, terminal_leitura, terminal_escrita);
+  es_registra_dispositivo(hw->es, D_TERM_B_TELA_INT   , terminal, 5, terminal_leitura, terminal_escrita);
+  // lê teclado, testa teclado, escreve tela, testa tela e interrupções do
+  //   terminal C
   terminal = console_terminal(hw->console, 'C');
   es_registra_dispositivo(hw->es, D_TERM_C_TECLADO    , terminal, 0, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_C_TECLADO_OK , terminal, 1, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_C_TELA       , terminal, 2, NULL, terminal_escrita);
   es_registra_dispositivo(hw->es, D_TERM_C_TELA_OK    , terminal, 3, terminal_leitura, NULL);
-  // lê teclado, testa teclado, escreve tela, testa tela do terminal D
+  es_registra_dispositivo(hw->es, D_TERM_C_TECLADO_INT, terminal, 4, terminal_leitura, terminal_escrita);
+  es_registra_dispositivo(hw->es, D_TERM_C_TELA_INT   , terminal, 5, terminal_leitura, terminal_escrita);
+  // lê teclado, testa teclado, escreve tela, testa tela e interrupções do
+  //   terminal D
   terminal = console_terminal(hw->console, 'D');
   es_registra_dispositivo(hw->es, D_TERM_D_TECLADO    , terminal, 0, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_D_TECLADO_OK , terminal, 1, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_D_TELA       , terminal, 2, NULL, terminal_escrita);
   es_registra_dispositivo(hw->es, D_TERM_D_TELA_OK    , terminal, 3, terminal_leitura, NULL);
+  es_registra_dispositivo(hw->es, D_TERM_D_TECLADO_INT, terminal, 4, terminal_leitura, terminal_escrita);
+  es_registra_dispositivo(hw->es, D_TERM_D_TELA_INT   , terminal, 5, terminal_leitura, terminal_escrita);
   // lê relógio virtual, relógio real
   es_registra_dispositivo(hw->es, D_RELOGIO_INSTRUCOES, hw->relogio, 0, relogio_leitura, NULL);
   es_registra_dispositivo(hw->es, D_RELOGIO_REAL      , hw->relogio, 1, relogio_leitura, NULL);
   es_registra_dispositivo(hw->es, D_RELOGIO_TIMER     , hw->relogio, 2, relogio_leitura, relogio_escrita);
   es_registra_dispositivo(hw->es, D_RELOGIO_INTERRUPCAO,hw->relogio, 3, relogio_leitura, relogio_escrita);
+  // IRQs pendentes e máscara do controlador de interrupções
+  es_registra_dispositivo(hw->es, D_PIC_PENDENTES     , hw->pic, 0, pic_leitura, NULL);
+  es_registra_dispositivo(hw->es, D_PIC_MASCARA       , hw->pic, 1, pic_leitura, pic_escrita);
 
   // cria a unidade de execução e inicializa com a memória e o controlador de E/S
   hw->cpu = cpu_cria(hw->mem, hw->es);
 
-  // cria o controlador da CPU e inicializa com a unidade de execução, a console e
-  //   o relógio
-  hw->controle = controle_cria(hw->cpu, hw->console, hw->relogio);
+  // cria o controlador da CPU e inicializa com a unidade de execução, a console,
+  //   o relógio, a agenda dos dispositivos e o controlador de interrupções
+  hw->controle = controle_cria(hw->cpu, hw->console, hw->relogio, hw->agenda,
+                               hw->pic);
 }
 
 static void destroi_hardware(hardware_t *hw)
@@ -87,19 +134,212 @@ static void destroi_hardware(hardware_t *hw)
   cpu_destroi(hw->cpu);
   es_destroi(hw->es);
   relogio_destroi(hw->relogio);
+  agenda_destroi(hw->agenda);
+  pic_destroi(hw->pic);
   console_destroi(hw->console);
   mem_destroi(hw->mem);
 }
 
-int main()
+static void erro_nos_args(char *nome_do_programa, char *msg, char *arg)
+{
+  fprintf(stderr, "ERRO: %s '%s'\n", msg, arg);
+  fprintf(stderr, "chame como '%s [-l] [-i intervalo] [-m max_instr] [-v nivel]"
+                  " [-A arq] [-B arq] [-C arq] [-D arq]"
+                  " [-c arq] [-e escalonador] [-q quantum] [-t intervalo]"
+                  " [-o arq] [-f formato] [-r intervalo] [-x custo] [-p programa]'\n",
+                  nome_do_programa);
+  fprintf(stderr, "  -l           modo lote: executa sem esperar comandos e termina sozinho\n");
+  fprintf(stderr, "  -i intervalo no modo lote, atualiza a console a cada tantas instruções\n");
+  fprintf(stderr, "               (0, o default, executa sem tela)\n");
+  fprintf(stderr, "  -m max_instr no modo lote, termina após tantas instruções\n");
+  fprintf(stderr, "  -v nivel     mensagens na console: 0 só erros, 1 sem os detalhes,\n");
+  fprintf(stderr, "               2 todas (o default)\n");
+  fprintf(stderr, "  -A a -D arq  lê a entrada do terminal correspondente do arquivo\n");
+  fprintf(stderr, "  -c arq       lê os parâmetros do SO do arquivo (uma linha 'nome valor'\n");
+  fprintf(stderr, "               por parâmetro, com os nomes das opções abaixo)\n");
+  fprintf(stderr, "  -e escalonador (escalonador) 0 simples, 1 round-robin, 2 prioridade,\n");
+  fprintf(stderr, "               3 múltiplas filas\n");
+  fprintf(stderr, "  -q quantum   (quantum) em interrupções do relógio\n");
+  fprintf(stderr, "  -t intervalo (intervalo) entre interrupções do relógio, em instruções\n");
+  fprintf(stderr, "  -o arq       (metricas) arquivo onde as métricas são escritas\n");
+  fprintf(stderr, "  -f formato   (formato) das métricas: texto, csv ou json\n");
+  fprintf(stderr, "  -r intervalo (amostras) em csv e json, grava as métricas também a cada\n");
+  fprintf(stderr, "               tantas instruções\n");
+  fprintf(stderr, "  -x custo     (troca) de cada troca de processo, em instruções\n");
+  fprintf(stderr, "  -p programa  (programa) programa do processo inicial (init.maq)\n");
+  fprintf(stderr, "               as opções valem na ordem em que aparecem\n");
+  exit(1);
+}
+
+// converte o argumento de uma opção em número
+static long pega_num(int argc, char *argv[argc], int argi)
+{
+  if (argi >= argc) erro_nos_args(argv[0], "falta valor após", argv[argi - 1]);
+  char *fim;
+  long num = strtol(argv[argi], &fim, 0);
+  if (*fim != '\0' || num < 0) erro_nos_args(argv[0], "valor inválido:", argv[argi]);
+  return num;
+}
+
+// converte o nome de um formato de métricas; retorna false se não conhece
+static bool pega_formato(char *nome, formato_metricas_t *pformato)
+{
+  static char *nomes[N_FORMATOS_METRICAS] = {
+    [METRICAS_TEXTO] = "texto",
+    [METRICAS_CSV]   = "csv",
+    [METRICAS_JSON]  = "json",
+  };
+  for (int f = 0; f < N_FORMATOS_METRICAS; f++) {
+    if (strcmp(nome, nomes[f]) == 0) {
+      *pformato = f;
+      return true;
+    }
+  }
+  return false;
+}
+
+// lê os parâmetros do SO do arquivo de configuração 'nome'
+// cada linha tem o nome de um parâmetro e seu valor; linhas vazias e o que
+//   estiver depois de '#' são ignorados
+static void le_config(char *nome_do_programa, char *nome, so_config_t *config)
+{
+  FILE *arq = fopen(nome, "r");
+  if (arq == NULL) erro_nos_args(nome_do_programa, "problema na abertura de", nome);
+  char linha[200];
+  int n_linha = 0;
+  while (fgets(linha, sizeof(linha), arq) != NULL) {
+    n_linha++;
+    char *comentario = strchr(linha, '#');
+    if (comentario != NULL) *comentario = '\0';
+    char param[50], valor[150];
+    int n = sscanf(linha, "%49s %149s", param, valor);
+    if (n <= 0) continue;
+    char *fim = "";
+    long num = (n == 2) ? strtol(valor, &fim, 0) : 0;
+    bool num_ok = n == 2 && *fim == '\0';
+    bool ok = true;
+    if (strcmp(param, "escalonador") == 0 && num_ok) {
+      config->escalonador = num;
+    } else if (strcmp(param, "quantum") == 0 && num_ok) {
+      config->quantum = num;
+    } else if (strcmp(param, "intervalo") == 0 && num_ok) {
+      config->intervalo_interrupcao = num;
+    } else if (strcmp(param, "metricas") == 0 && n == 2) {
+      // o SO guarda só o ponteiro, a cópia dura até o fim do programa
+      config->arq_metricas = strdup(valor);
+    } else if (strcmp(param, "programa") == 0 && n == 2) {
+      config->programa_inicial = strdup(valor);
+    } else if (strcmp(param, "formato") == 0 && n == 2) {
+      ok = pega_formato(valor, &config->formato_metricas);
+    } else if (strcmp(param, "amostras") == 0 && num_ok) {
+      config->intervalo_amostras = num;
+    } else if (strcmp(param, "troca") == 0 && num_ok) {
+      config->custo_troca = num;
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      fprintf(stderr, "ERRO: %s:%d: parâmetro inválido '%s'\n", nome, n_linha, param);
+      exit(1);
+    }
+  }
+  fclose(arq);
+}
+
+static void verifica_args(int argc, char *argv[argc], opcoes_t *opcoes)
+{
+  opcoes->lote = false;
+  opcoes->intervalo_console = 0;
+  opcoes->max_instrucoes = 0;
+  opcoes->nivel_console = MSG_DETALHE;
+  for (int t = 0; t < 4; t++) opcoes->entrada[t] = NULL;
+  so_config_padrao(&opcoes->so);
+
+  for (int argi = 1; argi < argc; argi++) {
+    char *arg = argv[argi];
+    if (strcmp(arg, "-l") == 0) {
+      opcoes->lote = true;
+    } else if (strcmp(arg, "-i") == 0) {
+      argi++;
+      opcoes->intervalo_console = pega_num(argc, argv, argi);
+    } else if (strcmp(arg, "-m") == 0) {
+      argi++;
+      opcoes->max_instrucoes = pega_num(argc, argv, argi);
+    } else if (strcmp(arg, "-v") == 0) {
+      argi++;
+      long nivel = pega_num(argc, argv, argi);
+      if (nivel > MSG_DETALHE) erro_nos_args(argv[0], "nível inválido:", argv[argi]);
+      opcoes->nivel_console = nivel;
+    } else if (arg[0] == '-' && arg[1] >= 'A' && arg[1] <= 'D' && arg[2] == '\0') {
+      argi++;
+      if (argi >= argc) erro_nos_args(argv[0], "falta arquivo após", arg);
+      opcoes->entrada[arg[1] - 'A'] = argv[argi];
+    } else if (strcmp(arg, "-c") == 0) {
+      argi++;
+      if (argi >= argc) erro_nos_args(argv[0], "falta arquivo após", arg);
+      le_config(argv[0], argv[argi], &opcoes->so);
+    } else if (strcmp(arg, "-e") == 0) {
+      argi++;
+      opcoes->so.escalonador = pega_num(argc, argv, argi);
+    } else if (strcmp(arg, "-q") == 0) {
+      argi++;
+      opcoes->so.quantum = pega_num(argc, argv, argi);
+    } else if (strcmp(arg, "-t") == 0) {
+      argi++;
+      opcoes->so.intervalo_interrupcao = pega_num(argc, argv, argi);
+    } else if (strcmp(arg, "-o") == 0) {
+      argi++;
+      if (argi >= argc) erro_nos_args(argv[0], "falta arquivo após", arg);
+      opcoes->so.arq_metricas = argv[argi];
+    } else if (strcmp(arg, "-p") == 0) {
+      argi++;
+      if (argi >= argc) erro_nos_args(argv[0], "falta arquivo após", arg);
+      opcoes->so.programa_inicial = argv[argi];
+    } else if (strcmp(arg, "-f") == 0) {
+      argi++;
+      if (argi >= argc) erro_nos_args(argv[0], "falta formato após", arg);
+      if (!pega_formato(argv[argi], &opcoes->so.formato_metricas)) {
+        erro_nos_args(argv[0], "formato desconhecido:", argv[argi]);
+      }
+    } else if (strcmp(arg, "-r") == 0) {
+      argi++;
+      opcoes->so.intervalo_amostras = pega_num(argc, argv, argi);
+    } else if (strcmp(arg, "-x") == 0) {
+      argi++;
+      opcoes->so.custo_troca = pega_num(argc, argv, argi);
+    } else {
+      erro_nos_args(argv[0], "argumento desconhecido:", arg);
+    }
+  }
+}
+
+int main(int argc, char *argv[argc])
 {
   hardware_t hw;
   so_t *so;
+  opcoes_t opcoes;
+
+  verifica_args(argc, argv, &opcoes);
+  if (!so_config_valida(&opcoes.so)) {
+    erro_nos_args(argv[0], "parâmetros do SO inválidos", "-e/-q/-t");
+  }
 
   // cria o hardware
-  cria_hardware(&hw);
+  // no modo lote, só usa a tela se for para atualizar a console de vez em quando
+  cria_hardware(&hw, !opcoes.lote || opcoes.intervalo_console > 0);
+  console_define_nivel(hw.console, opcoes.nivel_console);
+  for (int t = 0; t < 4; t++) {
+    if (opcoes.entrada[t] == NULL) continue;
+    if (!console_define_entrada(hw.console, 'A' + t, opcoes.entrada[t])) {
+      console_printf("problema na abertura do arquivo '%s'", opcoes.entrada[t]);
+    }
+  }
+  if (opcoes.lote) {
+    controle_define_lote(hw.controle, opcoes.intervalo_console,
+                         opcoes.max_instrucoes);
+  }
   // cria o sistema operacional
-  so = so_cria(hw.cpu, hw.mem, hw.es, hw.console);
+  so = so_cria(hw.cpu, hw.mem, hw.es, hw.console, &opcoes.so);
   
   // executa o laço principal do controlador
   controle_laco(hw.controle);
@@ -0,0 +1,131 @@
+// mapa.c
+// mapa de inteiros para inteiros (tabela hash)
+// simulador de computador
+// so24b
+
+#include "mapa.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+// marcas na chave de uma entrada que não tem valor
+#define VAZIA    -1
+#define REMOVIDA -2
+
+// uma entrada da tabela
+typedef struct {
+  int chave;
+  int valor;
+} entrada_t;
+
+struct mapa_t {
+  // tabela de 'cap' entradas (potência de 2)
+  entrada_t *tabela;
+  int cap;
+  // entradas com chave, e com marca de removida
+  int tam;
+  int n_removidas;
+};
+
+static void mapa__aloca(mapa_t *self, int cap)
+{
+  self->tabela = malloc(cap * sizeof(*self->tabela));
+  assert(self->tabela != NULL);
+  for (int i = 0; i < cap; i++) {
+    self->tabela[i].chave = VAZIA;
+  }
+  self->cap = cap;
+  self->tam = 0;
+  self->n_removidas = 0;
+}
+
+mapa_t *mapa_cria(void)
+{
+  mapa_t *self = malloc(sizeof(*self));
+  assert(self != NULL);
+
+  mapa__aloca(self, 16);
+
+  return self;
+}
+
+void mapa_destroi(mapa_t *self)
+{
+  free(self->tabela);
+  free(self);
+}
+
+// posição inicial da sondagem da chave
+// as chaves do SO são sequenciais, a multiplicação espalha elas pela tabela
+static int mapa__posicao(mapa_t *self, int chave)
+{
+  return ((unsigned)chave * 2654435761u) & (self->cap - 1);
+}
+
+// retorna a posição da chave na tabela, ou -1 se ela não está
+static int mapa__acha(mapa_t *self, int chave)
+{
+  int i = mapa__posicao(self, chave);
+  while (self->tabela[i].chave != VAZIA) {
+    if (self->tabela[i].chave == chave) return i;
+    i = (i + 1) & (self->cap - 1);
+  }
+  return -1;
+}
+
+// refaz a tabela com capacidade 'cap', descartando as marcas de removida
+static void mapa__refaz(mapa_t *self, int cap)
+{
+  entrada_t *velha = self->tabela;
+  int cap_velha = self->cap;
+  mapa__aloca(self, cap);
+  for (int i = 0; i < cap_velha; i++) {
+    if (velha[i].chave >= 0) mapa_insere(self, velha[i].chave, velha[i].valor);
+  }
+  free(velha);
+}
+
+void mapa_insere(mapa_t *self, int chave, int valor)
+{
+  assert(chave >= 0);
+  int i = mapa__acha(self, chave);
+  if (i >= 0) {
+    self->tabela[i].valor = valor;
+    return;
+  }
+  // as marcas também alongam a sondagem, contam na ocupação
+  if (2 * (self->tam + self->n_removidas + 1) > self->cap) {
+    // se são as marcas que ocupam, refaz do mesmo tamanho
+    mapa__refaz(self, 2 * (self->tam + 1) > self->cap / 2 ? 2 * self->cap : self->cap);
+  }
+  i = mapa__posicao(self, chave);
+  while (self->tabela[i].chave >= 0) {
+    i = (i + 1) & (self->cap - 1);
+  }
+  if (self->tabela[i].chave == REMOVIDA) self->n_removidas--;
+  self->tabela[i].chave = chave;
+  self->tabela[i].valor = valor;
+  self->tam++;
+}
+
+void mapa_remove(mapa_t *self, int chave)
+{
+  int i = mapa__acha(self, chave);
+  if (i < 0) return;
+  self->tabela[i].chave = REMOVIDA;
+  self->tam--;
+  self->n_removidas++;
+}
+
+int mapa_busca(mapa_t *self, int chave)
+{
+  if (chave < 0) return -1;
+  int i = mapa__acha(self, chave);
+  if (i < 0) return -1;
+  return self->tabela[i].valor;
+}
+
+int mapa_tam(mapa_t *self)
+{
+  return self->tam;
+}
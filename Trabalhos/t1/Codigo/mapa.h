@@ -0,0 +1,44 @@
+// mapa.h
+// mapa de inteiros para inteiros (tabela hash)
+// simulador de computador
+// so24b
+
+#ifndef MAPA_H
+#define MAPA_H
+
+// mapa de chaves inteiras (não negativas) para valores inteiros (não
+//   negativos), cada chave com no máximo um valor.
+//
+// é implementado com uma tabela hash de endereçamento aberto (sondagem
+//   linear), que dobra de tamanho quando fica mais da metade ocupada.
+//   uma chave removida deixa uma marca no lugar, para não interromper a
+//   sondagem das outras; as marcas são descartadas quando a tabela é
+//   refeita.
+// inserção, remoção e busca são O(1) em média.
+//
+// o SO usa para achar a posição de um processo na tabela de processos a
+//   partir do pid.
+
+typedef struct mapa_t mapa_t;
+
+// cria um mapa vazio
+mapa_t *mapa_cria(void);
+
+// destrói um mapa
+void mapa_destroi(mapa_t *self);
+
+// associa o valor 'valor' à chave 'chave'
+// se a chave já tem valor, ele é substituído
+void mapa_insere(mapa_t *self, int chave, int valor);
+
+// remove a chave 'chave' (e o seu valor) do mapa
+// não faz nada se a chave não está no mapa
+void mapa_remove(mapa_t *self, int chave);
+
+// retorna o valor associado à chave 'chave', ou -1 se ela não está no mapa
+int mapa_busca(mapa_t *self, int chave);
+
+// retorna o número de chaves no mapa
+int mapa_tam(mapa_t *self);
+
+#endif // MAPA_H
@@ -12,40 +12,76 @@
 struct relogio_t {
   // que horas são (em tics)
   int agora;
-  // quanto tempo até gerar uma interrupção
-  int t_ate_interrupcao;
+  // agenda onde é programado o fim da contagem até gerar uma interrupção
+  agenda_t *agenda;
+  evento_t fim_contagem;
   // 1 se está gerando interrupção, 0 se não
   int interrupcao;
+  // controlador avisado das mudanças em 'interrupcao' (NULL se não tiver)
+  pic_t *pic;
+  irq_t irq;
 };
 
-relogio_t *relogio_cria(void)
+static void relogio_fim_contagem(void *arg);
+
+relogio_t *relogio_cria(agenda_t *agenda)
 {
   relogio_t *self;
   self = malloc(sizeof(relogio_t));
   assert(self != NULL);
 
   self->agora = 0;
+  self->agenda = agenda;
+  evento_inicializa(&self->fim_contagem, relogio_fim_contagem, self);
+  self->interrupcao = 0;
+  self->pic = NULL;
 
   return self;
 }
 
 void relogio_destroi(relogio_t *self)
 {
+  agenda_cancela(self->agenda, &self->fim_contagem);
   free(self);
 }
 
-void relogio_tictac(relogio_t *self)
+void relogio_define_pic(relogio_t *self, pic_t *pic, irq_t irq)
+{
+  self->pic = pic;
+  self->irq = irq;
+}
+
+// altera o pedido de interrupção, avisando o controlador se mudou
+static void relogio_muda_interrupcao(relogio_t *self, int interrupcao)
 {
-  self->agora++;
-  // vê se tem que gerar interrupção
-  if (self->t_ate_interrupcao != 0) {
-    self->t_ate_interrupcao--;
-    if (self->t_ate_interrupcao == 0) {
-      self->interrupcao = 1;
-    }
+  if (interrupcao == self->interrupcao) return;
+  self->interrupcao = interrupcao;
+  if (self->pic == NULL) return;
+  if (interrupcao) {
+    pic_pede(self->pic, self->irq);
+  } else {
+    pic_retira(self->pic, self->irq);
   }
 }
 
+void relogio_tictac(relogio_t *self)
+{
+  relogio_avanca(self, 1);
+}
+
+void relogio_avanca(relogio_t *self, int n)
+{
+  // a interrupção é gerada pelo evento, quando a agenda avançar
+  self->agora += n;
+}
+
+// chamada pela agenda quando termina a contagem
+static void relogio_fim_contagem(void *arg)
+{
+  relogio_t *self = arg;
+  relogio_muda_interrupcao(self, 1);
+}
+
 int relogio_agora(relogio_t *self)
 {
   return self->agora;
@@ -63,7 +99,7 @@ err_t relogio_leitura(void *disp, int id, int *pvalor)
       *pvalor = clock()/(CLOCKS_PER_SEC/1000);
       break;
     case 2:
-      *pvalor = self->t_ate_interrupcao;
+      *pvalor = agenda_tempo_ate(self->agenda, &self->fim_contagem);
       break;
     case 3:
       *pvalor = self->interrupcao;
@@ -80,10 +116,15 @@ err_t relogio_escrita(void *disp, int id, int pvalor)
   err_t err = ERR_OK;
   switch (id) {
     case 2:
-      self->t_ate_interrupcao = pvalor;
+      // 0 (ou menos) desliga a contagem
+      if (pvalor > 0) {
+        agenda_programa(self->agenda, &self->fim_contagem, pvalor);
+      } else {
+        agenda_cancela(self->agenda, &self->fim_contagem);
+      }
       break;
     case 3:
-      self->interrupcao = (pvalor == 0) ? 0 : 1;
+      relogio_muda_interrupcao(self, (pvalor == 0) ? 0 : 1);
       break;
     default: 
       err = ERR_END_INV;
@@ -10,20 +10,33 @@
 // registra a passagem do tempo
 
 #include "err.h"
+#include "pic.h"
+#include "agenda.h"
 
 typedef struct relogio_t relogio_t;
 
 // cria e inicializa um relógio
-relogio_t *relogio_cria(void);
+// o fim da contagem para a interrupção é um evento programado em 'agenda',
+//   que deve avançar junto com o relógio
+relogio_t *relogio_cria(agenda_t *agenda);
 
 // destrói um relógio
 // nenhuma outra operação pode ser realizada no relógio após esta chamada
 void relogio_destroi(relogio_t *self);
 
+// define o controlador de interrupções avisado quando o relógio passa a
+//   pedir (e deixa de pedir) a interrupção 'irq'
+void relogio_define_pic(relogio_t *self, pic_t *pic, irq_t irq);
+
 // registra a passagem de uma unidade de tempo
-// esta função é chamada pelo controlador após a execução de cada instrução
+// esta função é chamada pelo controlador após a execução de cada instrução,
+//   junto com o avanço da agenda
 void relogio_tictac(relogio_t *self);
 
+// registra a passagem de 'n' unidades de tempo de uma vez (como 'n' chamadas
+//   a relogio_tictac)
+void relogio_avanca(relogio_t *self, int n);
+
 // retorna a hora atual do sistema, em unidades de tempo
 int relogio_agora(relogio_t *self);
 
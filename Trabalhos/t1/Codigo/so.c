@@ -7,32 +7,57 @@
 #include "so.h"
 #include "dispositivos.h"
 #include "irq.h"
+#include "fila_prio.h"
+#include "mapa.h"
 #include "programa.h"
 #include "instrucao.h"
 
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
+#include <assert.h>
 
 // CONSTANTES E TIPOS {{{1
+// os valores de INTERVALO_INTERRUPCAO, ESCALONADOR e QUANTUM são só os
+//   padrões, a configuração usada é a passada para so_cria (so_config_t)
 // intervalo entre interrupções do relógio
 #define INTERVALO_INTERRUPCAO 50   // em instruções executadas
 #define TAM_TABELA_PROCESSOS 8
 
-// define qual o escalonador a ser usado: 0 para simples, 1 para round-robin e 2 para prioridade
+// define qual o escalonador a ser usado: 0 para simples, 1 para round-robin, 2 para prioridade
+//   e 3 para múltiplas filas com realimentação
 #define ESCALONADOR 1
 #define QUANTUM 5
 
+// escalonador de múltiplas filas: número de níveis, quantum de cada nível (em
+//   interrupções do relógio, do nível mais prioritário, 0, para o menos) e
+//   intervalo entre as voltas de todos os processos para o nível 0
+#define MLFQ_NIVEIS 3
+static int mlfq_quantum[MLFQ_NIVEIS] = { 2, 5, 10 };
+#define MLFQ_PERIODO_BOOST 2000   // em instruções executadas
+
 typedef struct processo_t processo_t;
 typedef struct metricas_so_t metricas_so_t;
 typedef struct metricas_processo_t metricas_processo_t;
 
+// fila de processos bloqueados esperando alguma coisa (um processo morrer, um
+//   terminal), na ordem em que bloquearam; encadeada pelos descritores
+typedef struct {
+  processo_t *ini;
+  processo_t *fim;
+} fila_espera_t;
+
+#define N_TERMINAIS 4
+
 static void so_escalona_simples(so_t *self);
 static void so_escalona_round_robin(so_t *self);
 static void so_escalona_prioridade(so_t *self);
+static void so_escalona_mlfq(so_t *self);
 
 typedef void (*escalonador_func_t)(so_t *self);
-escalonador_func_t escalonadores[] = {so_escalona_simples, so_escalona_round_robin, so_escalona_prioridade};
+escalonador_func_t escalonadores[] = {so_escalona_simples, so_escalona_round_robin, so_escalona_prioridade, so_escalona_mlfq};
+#define N_ESCALONADORES (sizeof(escalonadores) / sizeof(escalonadores[0]))
 
 typedef enum {
   MORTO,
@@ -55,6 +80,9 @@ struct metricas_so_t {
   int t_ocioso;
   int n_interrupcoes[N_IRQ];
   int preempcoes;
+  // trocas do processo em execução e tempo gasto com elas (ver so_troca_contexto)
+  int n_trocas;
+  int t_troca_contexto;
 };
 
 struct metricas_processo_t {
@@ -63,10 +91,16 @@ struct metricas_processo_t {
   int n_estados[N_ESTADOS];
   int t_estados[N_ESTADOS];
   int t_resposta;
+  // instante em que o tempo no estado atual começou a ser contado; o tempo
+  //   só é acumulado em t_estados quando o estado muda (ou as métricas são
+  //   gravadas), não a cada interrupção
+  int t_mudanca;
 };
 
 struct processo_t {
   int process_id;
+  // posição na tabela de processos
+  int slot;
   int reg_a;
   int reg_x;
   int reg_pc;
@@ -77,6 +111,23 @@ struct processo_t {
   int terminal;
 
   float prioridade;
+  // nível no escalonador de múltiplas filas (0 é o mais prioritário)
+  int nivel;
+
+  // encadeamento na fila de prontos (na_fila é false se não estiver nela)
+  processo_t *fila_ant;
+  processo_t *fila_prox;
+  bool na_fila;
+
+  // processos bloqueados esperando este morrer (SO_ESPERA_PROC)
+  fila_espera_t esperas;
+  // fila de espera em que o processo está (NULL se não está em nenhuma), e
+  //   o encadeamento nela
+  fila_espera_t *em_espera;
+  processo_t *espera_ant;
+  processo_t *espera_prox;
+  // caractere a escrever, enquanto o pedido de escrita espera a tela
+  int dado_escrita;
 
   metricas_processo_t metricas;
 };
@@ -89,16 +140,52 @@ struct so_t {
   bool erro_interno;
 
   processo_t *processo_corrente;
+  // tabela de processos, com 'n_slots' posições usadas de 'max_processos'
+  // um processo morto continua na tabela até a sua posição ser usada por um
+  //   processo novo; as posições que podem ser reaproveitadas ficam na pilha
+  //   'slots_livres'
   processo_t **tabela_processos;
+  int n_slots;
+  int max_processos;
+  int *slots_livres;
+  int n_livres;
+  // posição na tabela de cada processo, pelo pid
+  mapa_t *slot_do_pid;
+  // métricas dos processos mortos que saíram da tabela (o descritor deles é
+  //   liberado), somadas, e quantos são
+  metricas_processo_t metricas_mortos;
+  int n_mortos;
+  // pid do próximo processo criado (os pids não são reaproveitados)
   int id_processo;
+  // processos criados, e que ainda não morreram
   int qnt_processos;
-  int max_processos;
+  int n_vivos;
+
+  so_config_t config;
 
   int quantum;
-  processo_t **fila_prontos;
+  // fila de prontos, duplamente encadeada pelos descritores dos processos,
+  //   para inserir no fim e remover qualquer processo em tempo constante
+  processo_t *fila_ini;
+  processo_t *fila_fim;
+  int n_prontos;
+  // pedidos de leitura e de escrita esperando cada terminal (o índice é o
+  //   terminal / 4), atendidos na ordem de chegada quando ele fica pronto
+  fila_espera_t esperas_teclado[N_TERMINAIS];
+  fila_espera_t esperas_tela[N_TERMINAIS];
+  // os mesmos processos prontos, ordenados por prioridade (pid como
+  //   identificador), para os escalonadores por prioridade e de múltiplas
+  //   filas (ver chave_pronto)
+  fila_prio_t *prontos_prio;
+  // quando os processos voltaram para o nível 0 no escalonador de múltiplas filas
+  int ultimo_boost;
 
   int relogio;
   metricas_so_t metricas;
+  // arquivo de métricas, aberto na primeira amostra (NULL se não estiver aberto)
+  FILE *arq_metricas;
+  // instante da próxima amostra das métricas
+  int proxima_amostra;
 };
 
 
@@ -124,6 +211,12 @@ static bool copia_str_da_mem(int tam, char str[tam], mem_t *mem, int ender);
 static processo_t *cria_processo(int process_id, int reg_pc);
 static void mata_processo(so_t *self, int process_id);
 static processo_t *busca_processo(so_t *self, int process_id);
+static void libera_slot(so_t *self, processo_t *proc);
+static void sai_da_espera(processo_t *proc);
+static void entra_na_espera(processo_t *proc, fila_espera_t *fila);
+static fila_espera_t *fila_do_terminal(so_t *self, int terminal, process_r_bloq_t razao);
+static void acorda_esperas(so_t *self, processo_t *proc);
+void ajusta_fila(so_t *self, processo_t *proc);
 static processo_t *so_adiciona_processo(so_t *self, char *nome_do_executavel);
 
 
@@ -136,22 +229,65 @@ static void inicializa_metricas_processo(metricas_processo_t *metricas){
     metricas->t_estados[i] = 0;
   }
   metricas->t_resposta = 0;
+  metricas->t_mudanca = 0;
 
   metricas->n_estados[PRONTO] = 1;
 }
 
-static void atualiza_metricas_processo(processo_t *proc, int d_tempo){
+// acumula o tempo que o processo passou no estado atual até 'agora'
+static void acumula_tempo_estado(processo_t *proc, int agora){
+  int d_tempo = agora - proc->metricas.t_mudanca;
   if (proc->estado != MORTO){
     proc->metricas.t_retorno += d_tempo;
   }
   proc->metricas.t_estados[proc->estado] += d_tempo;
-  proc->metricas.t_resposta = proc->metricas.t_estados[PRONTO] / proc->metricas.n_estados[PRONTO];
+  proc->metricas.t_mudanca = agora;
+}
+
+// acumula o tempo que os mortos que saíram da tabela passaram mortos até agora
+static void acumula_tempo_mortos(so_t *self){
+  metricas_processo_t *soma = &self->metricas_mortos;
+  soma->t_estados[MORTO] += self->n_mortos * (self->relogio - soma->t_mudanca);
+  soma->t_mudanca = self->relogio;
+}
+
+// soma as métricas do processo morto às dos que saíram da tabela
+static void soma_metricas_morto(so_t *self, processo_t *proc){
+  metricas_processo_t *soma = &self->metricas_mortos;
+  acumula_tempo_mortos(self);
+  acumula_tempo_estado(proc, self->relogio);
+  soma->t_retorno += proc->metricas.t_retorno;
+  soma->preempcoes += proc->metricas.preempcoes;
+  for (int i = 0; i < N_ESTADOS; i++){
+    soma->n_estados[i] += proc->metricas.n_estados[i];
+    soma->t_estados[i] += proc->metricas.t_estados[i];
+  }
+  self->n_mortos++;
+}
+
+// tempo de resposta: tempo médio no estado pronto
+static void calcula_t_resposta(metricas_processo_t *metricas){
+  int n = metricas->n_estados[PRONTO];
+  metricas->t_resposta = n == 0 ? 0 : metricas->t_estados[PRONTO] / n;
+}
+
+// põe em dia as métricas de todos os processos, para serem gravadas
+static void atualiza_metricas_processos(so_t *self){
+  for (int i = 0; i < self->n_slots; i++){
+    processo_t *proc = self->tabela_processos[i];
+    acumula_tempo_estado(proc, self->relogio);
+    calcula_t_resposta(&proc->metricas);
+  }
+  acumula_tempo_mortos(self);
+  calcula_t_resposta(&self->metricas_mortos);
 }
 
 static void inicializa_metricas_so(metricas_so_t *metricas){
   metricas->t_total = 0;
   metricas->t_ocioso = 0;
   metricas->preempcoes = 0;
+  metricas->n_trocas = 0;
+  metricas->t_troca_contexto = 0;
   for (int i = 0; i < N_IRQ; i++){
     metricas->n_interrupcoes[i] = 0;
   }
@@ -162,15 +298,12 @@ static void atualiza_metricas_so(so_t *self, int d_tempo){
   if (self->processo_corrente == NULL){
     self->metricas.t_ocioso += d_tempo;
   }
-  for (int i = 0; i < self->qnt_processos; i++){
-    atualiza_metricas_processo(self->tabela_processos[i], d_tempo);
-  }
 }
 
 static void calcula_metricas(so_t *self){
   int relogio_ant = self->relogio;
   if (es_le(self->es, D_RELOGIO_INSTRUCOES, &self->relogio) != ERR_OK){
-    console_printf("SO: problema no acesso ao relógio");
+    console_log(MSG_ERRO, "SO: problema no acesso ao relógio");
     return;
   }
 
@@ -181,51 +314,237 @@ static void calcula_metricas(so_t *self){
 }
 
 int calcula_preempcoes(so_t *self){
-  int preempcoes = 0;
-  for (int i = 0; i < self->qnt_processos; i++){
+  int preempcoes = self->metricas_mortos.preempcoes;
+  for (int i = 0; i < self->n_slots; i++){
     preempcoes += self->tabela_processos[i]->metricas.preempcoes;
   }
   return preempcoes;
 }
 
-static void imprime_metricas(so_t *self){
-  self->metricas.preempcoes = calcula_preempcoes(self);
-  char nome[100];
-  sprintf(nome, "../Metricas/metricas_so_%d.txt", ESCALONADOR);
-  FILE *arq = fopen(nome, "w");
-  if (arq == NULL){
-    console_printf("SO: problema na abertura do arquivo de métricas");
-    return;
+// nomes dos estados dos processos, para os arquivos de métricas
+static char *nomes_estados[N_ESTADOS] = {
+  [MORTO]     = "morto",
+  [BLOQUEADO] = "bloqueado",
+  [PRONTO]    = "pronto",
+};
+
+// métricas de um processo (ou somadas, dos mortos que saíram da tabela) em texto
+static void grava_metricas_processo_texto(FILE *arq, metricas_processo_t *metricas){
+  fprintf(arq, "Tempo de retorno: %d\n", metricas->t_retorno);
+  fprintf(arq, "Preempções: %d\n", metricas->preempcoes);
+  fprintf(arq, "Tempo de resposta: %d\n", metricas->t_resposta);
+  for (int j = 0; j < N_ESTADOS; j++){
+    fprintf(arq, "Tempo no estado %d: %d\n", j, metricas->t_estados[j]);
+    fprintf(arq, "Número de vezes no estado %d: %d\n", j, metricas->n_estados[j]);
   }
+}
+
+// métricas em texto, para leitura humana (só no final da execução)
+static void grava_metricas_texto(so_t *self, FILE *arq){
   fprintf(arq, "MÉTRICAS DO SO:\n\n");
   fprintf(arq, "Tempo total: %d\n", self->metricas.t_total);
   fprintf(arq, "Tempo ocioso: %d\n", self->metricas.t_ocioso);
   fprintf(arq, "Número de processos: %d\n", self->qnt_processos);
   fprintf(arq, "Preempções: %d\n", self->metricas.preempcoes);
+  fprintf(arq, "Trocas de contexto: %d\n", self->metricas.n_trocas);
+  fprintf(arq, "Tempo em troca de contexto: %d\n", self->metricas.t_troca_contexto);
 
   for (int i = 0; i < N_IRQ; i++){
     fprintf(arq, "Interrupção %d: %d\n", i, self->metricas.n_interrupcoes[i]);
   }
 
   fprintf(arq, "\nMÉTRICAS DOS PROCESSOS:\n\n");
-  for (int i = 0; i < self->qnt_processos; i++){
+  for (int i = 0; i < self->n_slots; i++){
     processo_t *proc = self->tabela_processos[i];
     fprintf(arq, "Processo %d\n", proc->process_id);
-    fprintf(arq, "Tempo de retorno: %d\n", proc->metricas.t_retorno);
-    fprintf(arq, "Preempções: %d\n", proc->metricas.preempcoes);
-    fprintf(arq, "Tempo de resposta: %d\n", proc->metricas.t_resposta);
-    for (int j = 0; j < N_ESTADOS; j++){
-      fprintf(arq, "Tempo no estado %d: %d\n", j, proc->metricas.t_estados[j]);
-      fprintf(arq, "Número de vezes no estado %d: %d\n", j, proc->metricas.n_estados[j]);
-    }
+    grava_metricas_processo_texto(arq, &proc->metricas);
     fprintf(arq, "\n");
   }
+  // processos que saíram da tabela: métricas somadas, tempo de resposta médio
+  if (self->n_mortos > 0){
+    fprintf(arq, "Processos mortos: %d\n", self->n_mortos);
+    grava_metricas_processo_texto(arq, &self->metricas_mortos);
+    fprintf(arq, "\n");
+  }
+}
+
+// escreve uma string no CSV, entre aspas se precisar
+static void csv_str(FILE *arq, char *str){
+  if (strpbrk(str, ",\"\n") == NULL){
+    fputs(str, arq);
+    return;
+  }
+  fputc('"', arq);
+  for (char *c = str; *c != '\0'; c++){
+    if (*c == '"') fputc('"', arq);
+    fputc(*c, arq);
+  }
+  fputc('"', arq);
+}
+
+// processo das linhas do CSV com as métricas somadas dos mortos que saíram
+//   da tabela
+#define PID_MORTOS -1
+
+// uma linha do CSV de métricas: pid 0 para as métricas do SO, PID_MORTOS
+//   para as dos mortos que saíram da tabela; 'item' é o nome da interrupção
+//   ou do estado, para as métricas que têm um por item
+static void csv_linha(so_t *self, FILE *arq, int pid, char *metrica, char *item, int valor){
+  fprintf(arq, "%d,", self->relogio);
+  if (pid > 0) fprintf(arq, "%d", pid);
+  if (pid == PID_MORTOS) fprintf(arq, "mortos");
+  fprintf(arq, ",%s,", metrica);
+  if (item != NULL) csv_str(arq, item);
+  fprintf(arq, ",%d\n", valor);
+}
+
+// métricas de um processo (ou somadas, dos mortos que saíram da tabela) em CSV
+static void grava_metricas_processo_csv(so_t *self, FILE *arq, int pid,
+                                        metricas_processo_t *metricas){
+  csv_linha(self, arq, pid, "t_retorno", NULL, metricas->t_retorno);
+  csv_linha(self, arq, pid, "preempcoes", NULL, metricas->preempcoes);
+  csv_linha(self, arq, pid, "t_resposta", NULL, metricas->t_resposta);
+  for (int j = 0; j < N_ESTADOS; j++){
+    csv_linha(self, arq, pid, "t_estado", nomes_estados[j], metricas->t_estados[j]);
+    csv_linha(self, arq, pid, "n_estado", nomes_estados[j], metricas->n_estados[j]);
+  }
+}
+
+// métricas em CSV, uma linha por métrica
+static void grava_metricas_csv(so_t *self, FILE *arq){
+  csv_linha(self, arq, 0, "t_total", NULL, self->metricas.t_total);
+  csv_linha(self, arq, 0, "t_ocioso", NULL, self->metricas.t_ocioso);
+  csv_linha(self, arq, 0, "n_processos", NULL, self->qnt_processos);
+  csv_linha(self, arq, 0, "preempcoes", NULL, self->metricas.preempcoes);
+  csv_linha(self, arq, 0, "n_trocas", NULL, self->metricas.n_trocas);
+  csv_linha(self, arq, 0, "t_troca_contexto", NULL, self->metricas.t_troca_contexto);
+  for (int i = 0; i < N_IRQ; i++){
+    csv_linha(self, arq, 0, "n_interrupcoes", irq_nome(i), self->metricas.n_interrupcoes[i]);
+  }
+  for (int i = 0; i < self->n_slots; i++){
+    processo_t *proc = self->tabela_processos[i];
+    int pid = proc->process_id;
+    csv_linha(self, arq, pid, "estado", nomes_estados[proc->estado], proc->estado);
+    grava_metricas_processo_csv(self, arq, pid, &proc->metricas);
+  }
+  if (self->n_mortos > 0){
+    csv_linha(self, arq, PID_MORTOS, "n_processos", NULL, self->n_mortos);
+    grava_metricas_processo_csv(self, arq, PID_MORTOS, &self->metricas_mortos);
+  }
+}
+
+// escreve uma string JSON (os nomes usados não têm caracteres de controle)
+static void json_str(FILE *arq, char *str){
+  fputc('"', arq);
+  for (char *c = str; *c != '\0'; c++){
+    if (*c == '"' || *c == '\\') fputc('\\', arq);
+    fputc(*c, arq);
+  }
+  fputc('"', arq);
+}
+
+// escreve um objeto JSON com um valor para cada estado de processo
+static void json_por_estado(FILE *arq, int valores[N_ESTADOS]){
+  fprintf(arq, "{");
+  for (int j = 0; j < N_ESTADOS; j++){
+    if (j > 0) fprintf(arq, ",");
+    json_str(arq, nomes_estados[j]);
+    fprintf(arq, ":%d", valores[j]);
+  }
+  fprintf(arq, "}");
+}
+
+// métricas de um processo (ou somadas, dos mortos que saíram da tabela) em
+//   JSON, os campos sem as chaves do objeto
+static void grava_metricas_processo_json(FILE *arq, metricas_processo_t *metricas){
+  fprintf(arq, "\"t_retorno\":%d,\"preempcoes\":%d,\"t_resposta\":%d,",
+          metricas->t_retorno, metricas->preempcoes, metricas->t_resposta);
+  fprintf(arq, "\"t_estados\":");
+  json_por_estado(arq, metricas->t_estados);
+  fprintf(arq, ",\"n_estados\":");
+  json_por_estado(arq, metricas->n_estados);
+}
+
+// métricas em JSON, um objeto por linha (JSON Lines), para poder ser lido
+//   amostra a amostra enquanto o arquivo ainda está sendo escrito
+static void grava_metricas_json(so_t *self, FILE *arq, bool final){
+  fprintf(arq, "{\"instante\":%d,\"final\":%s,\"so\":{", self->relogio,
+          final ? "true" : "false");
+  fprintf(arq, "\"t_total\":%d,\"t_ocioso\":%d,\"n_processos\":%d,\"preempcoes\":%d,",
+          self->metricas.t_total, self->metricas.t_ocioso, self->qnt_processos,
+          self->metricas.preempcoes);
+  fprintf(arq, "\"n_trocas\":%d,\"t_troca_contexto\":%d,",
+          self->metricas.n_trocas, self->metricas.t_troca_contexto);
+  fprintf(arq, "\"n_interrupcoes\":{");
+  for (int i = 0; i < N_IRQ; i++){
+    if (i > 0) fprintf(arq, ",");
+    json_str(arq, irq_nome(i));
+    fprintf(arq, ":%d", self->metricas.n_interrupcoes[i]);
+  }
+  fprintf(arq, "}},\"processos\":[");
+  for (int i = 0; i < self->n_slots; i++){
+    processo_t *proc = self->tabela_processos[i];
+    if (i > 0) fprintf(arq, ",");
+    fprintf(arq, "{\"pid\":%d,\"estado\":", proc->process_id);
+    json_str(arq, nomes_estados[proc->estado]);
+    fprintf(arq, ",");
+    grava_metricas_processo_json(arq, &proc->metricas);
+    fprintf(arq, "}");
+  }
+  // os mortos que saíram da tabela, somados
+  fprintf(arq, "],\"mortos\":{\"n_processos\":%d,", self->n_mortos);
+  grava_metricas_processo_json(arq, &self->metricas_mortos);
+  fprintf(arq, "}}\n");
+}
+
+// grava as métricas no arquivo, no formato configurado: uma amostra durante
+//   a execução, ou as métricas finais ('final'), quando o arquivo é fechado
+// o formato texto só é gravado no final
+static void grava_metricas(so_t *self, bool final){
+  formato_metricas_t formato = self->config.formato_metricas;
+  if (!final && formato == METRICAS_TEXTO) return;
+  atualiza_metricas_processos(self);
+  self->metricas.preempcoes = calcula_preempcoes(self);
+  if (self->arq_metricas == NULL){
+    static char *extensoes[N_FORMATOS_METRICAS] = { "txt", "csv", "json" };
+    char nome[100];
+    char *arq_metricas = self->config.arq_metricas;
+    if (arq_metricas == NULL){
+      sprintf(nome, "../Metricas/metricas_so_%d.%s", self->config.escalonador,
+              extensoes[formato]);
+      arq_metricas = nome;
+    }
+    self->arq_metricas = fopen(arq_metricas, "w");
+    if (self->arq_metricas == NULL){
+      console_log(MSG_ERRO, "SO: problema na abertura do arquivo de métricas");
+      return;
+    }
+    if (formato == METRICAS_CSV){
+      fprintf(self->arq_metricas, "instante,processo,metrica,item,valor\n");
+    }
+  }
+  switch (formato){
+    case METRICAS_TEXTO:
+      grava_metricas_texto(self, self->arq_metricas);
+      break;
+    case METRICAS_CSV:
+      grava_metricas_csv(self, self->arq_metricas);
+      break;
+    default:
+      grava_metricas_json(self, self->arq_metricas, final);
+  }
+  fflush(self->arq_metricas);
+  if (final){
+    fclose(self->arq_metricas);
+    self->arq_metricas = NULL;
+  }
 }
 
 static processo_t *cria_processo(int process_id, int reg_pc){
   processo_t *processo = malloc(sizeof(processo_t));
 
   processo->process_id = process_id;
+  processo->slot = -1;
 
   processo->reg_a = 0;
   processo->reg_x = 0;
@@ -235,6 +554,16 @@ static processo_t *cria_processo(int process_id, int reg_pc){
   processo->razao = OK;
 
   processo->prioridade = 0.5;
+  processo->nivel = 0;
+  processo->fila_ant = NULL;
+  processo->fila_prox = NULL;
+  processo->na_fila = false;
+  processo->esperas.ini = NULL;
+  processo->esperas.fim = NULL;
+  processo->em_espera = NULL;
+  processo->espera_ant = NULL;
+  processo->espera_prox = NULL;
+  processo->dado_escrita = 0;
 
   processo->terminal = (process_id % 4) * 4;
 
@@ -244,41 +573,105 @@ static processo_t *cria_processo(int process_id, int reg_pc){
 }
 
 int tam_fila(so_t *self){
-  int i = 0;
-  while (self->fila_prontos[i] != NULL){
-    i++;
-  }
-  return i;
+  return self->n_prontos;
+}
+
+// chave do processo na fila de prioridade dos prontos: o nível no escalonador
+//   de múltiplas filas (processos do mesmo nível saem na ordem de chegada),
+//   a prioridade nos outros
+static float chave_pronto(so_t *self, processo_t *proc){
+  if (self->config.escalonador == 3) return proc->nivel;
+  return proc->prioridade;
+}
+
+// o primeiro da fila de prioridade dos prontos (NULL se estiver vazia)
+static processo_t *primeiro_pronto(so_t *self){
+  int slot = fila_prio_primeiro(self->prontos_prio);
+  if (slot < 0) return NULL;
+  return self->tabela_processos[slot];
 }
 
 static void remove_fila(so_t *self, int process_id){
-  processo_t *aux;
-  for (int i = 0; i < tam_fila(self); i++){
-    aux = self->fila_prontos[i];
-    if (aux->process_id == process_id){
-      for (int j = i; j < tam_fila(self) - 1; j++){
-        self->fila_prontos[j] = self->fila_prontos[j+1];
-      }
-      self->fila_prontos[tam_fila(self) - 1] = NULL;
-      return;
-    }
-  }
+  processo_t *proc = busca_processo(self, process_id);
+  if (proc == NULL || !proc->na_fila) return;
+
+  if (proc->fila_ant != NULL) {
+    proc->fila_ant->fila_prox = proc->fila_prox;
+  } else {
+    self->fila_ini = proc->fila_prox;
+  }
+  if (proc->fila_prox != NULL) {
+    proc->fila_prox->fila_ant = proc->fila_ant;
+  } else {
+    self->fila_fim = proc->fila_ant;
+  }
+  proc->fila_ant = NULL;
+  proc->fila_prox = NULL;
+  proc->na_fila = false;
+  self->n_prontos--;
+  fila_prio_remove(self->prontos_prio, proc->slot);
 }
 
 static void mata_processo(so_t *self, int process_id){
-  if (process_id <= 0 || process_id > self->qnt_processos) return;
-
-  processo_t *proc = self->tabela_processos[process_id-1];
+  processo_t *proc = busca_processo(self, process_id);
+  if (proc == NULL || proc->estado == MORTO) return;
+  acumula_tempo_estado(proc, self->relogio);
   proc->estado = MORTO;
   proc->metricas.n_estados[proc->estado]++;
 
   remove_fila(self, process_id);
+  sai_da_espera(proc);
+  acorda_esperas(self, proc);
+  self->n_vivos--;
+  libera_slot(self, proc);
 }
 
 static processo_t *busca_processo(so_t *self, int process_id){
-  if (process_id <= 0 || process_id > self->qnt_processos) return NULL;
+  int slot = mapa_busca(self->slot_do_pid, process_id);
+  if (slot < 0) return NULL;
+
+  return self->tabela_processos[slot];
+}
 
-  return self->tabela_processos[process_id-1];
+// retorna true se o processo já existiu e morreu (esteja ou não na tabela)
+static bool processo_morto(so_t *self, int process_id){
+  processo_t *proc = busca_processo(self, process_id);
+  if (proc == NULL) return process_id > 0 && process_id < self->id_processo;
+  return proc->estado == MORTO;
+}
+
+// a posição do processo morto pode ser usada por outro
+static void libera_slot(so_t *self, processo_t *proc){
+  self->slots_livres[self->n_livres++] = proc->slot;
+}
+
+// tira da tabela o processo morto, somando as métricas dele às dos mortos
+//   que já saíram, e libera o descritor
+static void descarta_morto(so_t *self, processo_t *proc){
+  soma_metricas_morto(self, proc);
+  mapa_remove(self->slot_do_pid, proc->process_id);
+  free(proc);
+}
+
+// coloca o processo na tabela, na posição de um morto se tiver alguma livre
+static void insere_processo(so_t *self, processo_t *proc){
+  int slot;
+  if (self->n_livres > 0){
+    slot = self->slots_livres[--self->n_livres];
+    descarta_morto(self, self->tabela_processos[slot]);
+  } else {
+    if (self->n_slots == self->max_processos){
+      self->max_processos = self->max_processos * 2;
+      self->tabela_processos = realloc(self->tabela_processos, self->max_processos * sizeof(*self->tabela_processos));
+      self->slots_livres = realloc(self->slots_livres, self->max_processos * sizeof(*self->slots_livres));
+      assert(self->tabela_processos != NULL && self->slots_livres != NULL);
+    }
+    slot = self->n_slots++;
+  }
+  self->tabela_processos[slot] = proc;
+  proc->slot = slot;
+  mapa_insere(self->slot_do_pid, proc->process_id, slot);
+  self->n_vivos++;
 }
 
 static processo_t *so_adiciona_processo(so_t *self, char *nome_do_executavel){
@@ -288,16 +681,11 @@ static processo_t *so_adiciona_processo(so_t *self, char *nome_do_executavel){
     return NULL;
   }
 
-  if (self->qnt_processos == self->max_processos){
-    self->max_processos = self->max_processos * 2;
-    self->tabela_processos = realloc(self->tabela_processos, self->max_processos * sizeof(*self->tabela_processos));
-    self->fila_prontos = realloc(self->fila_prontos, self->max_processos * sizeof(*self->fila_prontos));
-  }
-
   processo_t *processo = cria_processo(self->id_processo, ender);
+  processo->metricas.t_mudanca = self->relogio;
 
-  self->tabela_processos[self->qnt_processos] = processo;
-  self->fila_prontos[tam_fila(self)] = processo;
+  insere_processo(self, processo);
+  ajusta_fila(self, processo);
 
   self->qnt_processos++;
   self->id_processo++;
@@ -305,7 +693,8 @@ static processo_t *so_adiciona_processo(so_t *self, char *nome_do_executavel){
   return processo;
 }
 
-void muda_estado_processo(processo_t *proc, process_estado_t estado, process_r_bloq_t razao){
+void muda_estado_processo(so_t *self, processo_t *proc, process_estado_t estado, process_r_bloq_t razao){
+  acumula_tempo_estado(proc, self->relogio);
   proc->estado = estado;
   proc->razao = razao;
   proc->metricas.n_estados[proc->estado]++;
@@ -313,7 +702,30 @@ void muda_estado_processo(processo_t *proc, process_estado_t estado, process_r_b
 
 // CRIAÇÃO {{{1
 
-so_t *so_cria(cpu_t *cpu, mem_t *mem, es_t *es, console_t *console)
+void so_config_padrao(so_config_t *config)
+{
+  config->escalonador = ESCALONADOR;
+  config->quantum = QUANTUM;
+  config->intervalo_interrupcao = INTERVALO_INTERRUPCAO;
+  config->arq_metricas = NULL;
+  config->programa_inicial = "init.maq";
+  config->formato_metricas = METRICAS_TEXTO;
+  config->intervalo_amostras = 0;
+  config->custo_troca = 0;
+}
+
+bool so_config_valida(so_config_t *config)
+{
+  if (config->escalonador < 0 || config->escalonador >= N_ESCALONADORES) return false;
+  if (config->quantum <= 0 || config->intervalo_interrupcao <= 0) return false;
+  if (config->formato_metricas < 0 || config->formato_metricas >= N_FORMATOS_METRICAS) return false;
+  if (config->intervalo_amostras < 0) return false;
+  if (config->custo_troca < 0) return false;
+  return true;
+}
+
+so_t *so_cria(cpu_t *cpu, mem_t *mem, es_t *es, console_t *console,
+              so_config_t *config)
 {
   so_t *self = malloc(sizeof(*self));
   if (self == NULL) return NULL;
@@ -323,31 +735,55 @@ so_t *so_cria(cpu_t *cpu, mem_t *mem, es_t *es, console_t *console)
   self->es = es;
   self->console = console;
   self->erro_interno = false;
+  self->config = *config;
 
   self->id_processo = 1;
   self->qnt_processos = 0;
+  self->n_vivos = 0;
+  self->n_slots = 0;
   self->max_processos = TAM_TABELA_PROCESSOS;
   self->processo_corrente = NULL;
   self->tabela_processos = malloc(self->max_processos * sizeof(processo_t *));
-
-  self->fila_prontos = malloc(self->max_processos * sizeof(processo_t *));
-  self->quantum = QUANTUM;
+  self->slots_livres = malloc(self->max_processos * sizeof(int));
+  self->n_livres = 0;
+  self->slot_do_pid = mapa_cria();
+  inicializa_metricas_processo(&self->metricas_mortos);
+  self->metricas_mortos.n_estados[PRONTO] = 0;
+  self->n_mortos = 0;
+
+  self->fila_ini = NULL;
+  self->fila_fim = NULL;
+  self->n_prontos = 0;
+  for (int i = 0; i < N_TERMINAIS; i++) {
+    self->esperas_teclado[i] = (fila_espera_t){ NULL, NULL };
+    self->esperas_tela[i] = (fila_espera_t){ NULL, NULL };
+  }
+  self->prontos_prio = fila_prio_cria();
+  self->ultimo_boost = 0;
+  self->quantum = self->config.quantum;
 
   self->relogio = -1;
 
   inicializa_metricas_so(&self->metricas);
+  self->arq_metricas = NULL;
+  self->proxima_amostra = self->config.intervalo_amostras;
 
   cpu_define_chamaC(self->cpu, so_trata_interrupcao, self);
 
+  if (!so_config_valida(&self->config)) {
+    console_log(MSG_ERRO, "SO: configuração inválida");
+    self->erro_interno = true;
+  }
+
   int ender = so_carrega_programa(self, "trata_int.maq");
   if (ender != IRQ_END_TRATADOR) {
-    console_printf("SO: problema na carga do programa de tratamento de interrupção");
+    console_log(MSG_ERRO, "SO: problema na carga do programa de tratamento de interrupção");
     self->erro_interno = true;
   }
 
-  // programa o relógio para gerar uma interrupção após INTERVALO_INTERRUPCAO
-  if (es_escreve(self->es, D_RELOGIO_TIMER, INTERVALO_INTERRUPCAO) != ERR_OK) {
-    console_printf("SO: problema na programação do timer");
+  // programa o relógio para gerar uma interrupção após o intervalo configurado
+  if (es_escreve(self->es, D_RELOGIO_TIMER, self->config.intervalo_interrupcao) != ERR_OK) {
+    console_log(MSG_ERRO, "SO: problema na programação do timer");
     self->erro_interno = true;
   }
 
@@ -357,6 +793,15 @@ so_t *so_cria(cpu_t *cpu, mem_t *mem, es_t *es, console_t *console)
 void so_destroi(so_t *self)
 {
   cpu_define_chamaC(self->cpu, NULL, NULL);
+  fila_prio_destroi(self->prontos_prio);
+  // a execução terminou antes do fim do SO, o arquivo fica com as amostras
+  if (self->arq_metricas != NULL) fclose(self->arq_metricas);
+  for (int i = 0; i < self->n_slots; i++) {
+    free(self->tabela_processos[i]);
+  }
+  free(self->tabela_processos);
+  free(self->slots_livres);
+  mapa_destroi(self->slot_do_pid);
   free(self);
 }
 
@@ -370,14 +815,10 @@ static void so_trata_pendencias(so_t *self);
 static void so_escalona(so_t *self);
 
 static int so_despacha(so_t *self);
+static void so_troca_contexto(so_t *self, processo_t *anterior);
 
 bool tudo_morreu(so_t *self){
-  for (int i = 0; i < self->qnt_processos; i++){
-    if (self->tabela_processos[i]->estado != MORTO){
-      return false;
-    }
-  }
-  return true;
+  return self->n_vivos == 0;
 }
 
 static int finaliza_so(so_t *self){
@@ -386,11 +827,11 @@ static int finaliza_so(so_t *self){
   e2 = es_escreve(self->es, D_RELOGIO_INTERRUPCAO, 0);
   if (e1 != ERR_OK || e2 != ERR_OK)
   {
-    console_printf("SO: nao consigo desligar o timer!!");
+    console_log(MSG_ERRO, "SO: nao consigo desligar o timer!!");
     self->erro_interno = true;
   }
 
-  imprime_metricas(self);
+  grava_metricas(self, true);
 
   return 1;
 }
@@ -400,10 +841,15 @@ static int so_trata_interrupcao(void *argC, int reg_A)
 {
   so_t *self = argC;
   irq_t irq = reg_A;
+  processo_t *anterior = self->processo_corrente;
  
   self->metricas.n_interrupcoes[irq]++;
 
   calcula_metricas(self);
+  if (self->config.intervalo_amostras > 0 && self->relogio >= self->proxima_amostra){
+    grava_metricas(self, false);
+    self->proxima_amostra = self->relogio + self->config.intervalo_amostras;
+  }
 
   // salva o estado da cpu no descritor do processo que foi interrompido
   so_salva_estado_da_cpu(self);
@@ -413,6 +859,8 @@ static int so_trata_interrupcao(void *argC, int reg_A)
   so_trata_pendencias(self);
   // escolhe o próximo processo a executar
   so_escalona(self);
+  // cobra a troca, se o processo escolhido não é o que foi interrompido
+  so_troca_contexto(self, anterior);
   // recupera o estado do processo escolhido
 
   if (!tudo_morreu(self)){
@@ -442,100 +890,171 @@ static void so_salva_estado_da_cpu(so_t *self)
 
 // função que ajusta a fila de processos, coloca o processo no fim da fila
 void ajusta_fila(so_t *self, processo_t *proc){
-  self->fila_prontos[tam_fila(self)] = proc;
+  if (proc->na_fila) return;
+  proc->fila_ant = self->fila_fim;
+  proc->fila_prox = NULL;
+  if (self->fila_fim != NULL) {
+    self->fila_fim->fila_prox = proc;
+  } else {
+    self->fila_ini = proc;
+  }
+  self->fila_fim = proc;
+  proc->na_fila = true;
+  self->n_prontos++;
+  fila_prio_insere(self->prontos_prio, proc->slot, chave_pronto(self, proc));
+}
+
+// coloca o processo no fim da fila de espera
+static void entra_na_espera(processo_t *proc, fila_espera_t *fila){
+  proc->em_espera = fila;
+  proc->espera_ant = fila->fim;
+  proc->espera_prox = NULL;
+  if (fila->fim != NULL) {
+    fila->fim->espera_prox = proc;
+  } else {
+    fila->ini = proc;
+  }
+  fila->fim = proc;
+}
+
+// tira o processo da fila de espera em que está (se estiver em alguma)
+static void sai_da_espera(processo_t *proc){
+  fila_espera_t *fila = proc->em_espera;
+  if (fila == NULL) return;
+  if (proc->espera_ant != NULL) {
+    proc->espera_ant->espera_prox = proc->espera_prox;
+  } else {
+    fila->ini = proc->espera_prox;
+  }
+  if (proc->espera_prox != NULL) {
+    proc->espera_prox->espera_ant = proc->espera_ant;
+  } else {
+    fila->fim = proc->espera_ant;
+  }
+  proc->em_espera = NULL;
+  proc->espera_ant = NULL;
+  proc->espera_prox = NULL;
+}
+
+// fila dos pedidos que esperam o teclado (razao LEITURA) ou a tela (ESCRITA)
+//   do terminal
+static fila_espera_t *fila_do_terminal(so_t *self, int terminal, process_r_bloq_t razao){
+  if (razao == LEITURA) return &self->esperas_teclado[terminal / 4];
+  return &self->esperas_tela[terminal / 4];
 }
 
-void trata_le(so_t *self, processo_t *proc){
+// atende o pedido de leitura do processo, se o teclado tiver um caractere;
+//   retorna false se não tiver
+bool trata_le(so_t *self, processo_t *proc){
   int estado;
   int terminal = proc->terminal;
 
   if (es_le(self->es, terminal_processo(terminal, TECLADO_OK), &estado) == ERR_OK && estado != 0) {
-    muda_estado_processo(proc, PRONTO, OK);
+    sai_da_espera(proc);
+    muda_estado_processo(self, proc, PRONTO, OK);
     ajusta_fila(self, proc);
-    console_printf("SO: desbloqueado processo %d. haha - leitura", proc->process_id);
+    console_log(MSG_DETALHE, "SO: desbloqueado processo %d. haha - leitura", proc->process_id);
 
     int dado;
     es_le(self->es, terminal_processo(terminal, TECLADO), &dado);
     proc->reg_a = dado;
+    return true;
   }
-  return;
+  return false;
 }
 
-void trata_escreve(so_t *self, processo_t *proc){
+// atende o pedido de escrita do processo, se a tela puder receber um
+//   caractere; retorna false se não puder
+bool trata_escreve(so_t *self, processo_t *proc){
   int estado;
   int terminal = proc->terminal;
 
   if (es_le(self->es, terminal_processo(terminal, TELA_OK), &estado) == ERR_OK && estado != 0) {
-    int dado = proc->reg_x;
+    int dado = proc->dado_escrita;
     if (es_escreve(self->es, terminal_processo(terminal, TELA), dado) == ERR_OK) {
-    muda_estado_processo(proc, PRONTO, OK);
+      sai_da_espera(proc);
+      muda_estado_processo(self, proc, PRONTO, OK);
+      proc->reg_a = 0;
       ajusta_fila(self, proc);
-      console_printf("SO: desbloqueado processo %d. haha - escrita", proc->process_id);
+      console_log(MSG_DETALHE, "SO: desbloqueado processo %d. haha - escrita", proc->process_id);
+      return true;
     }
   }
-  return;
+  return false;
 }
 
-static void trata_espera(so_t *self, processo_t *proc){
-  int id_alvo = proc->reg_x;
-
-  processo_t *alvo = busca_processo(self, id_alvo);
-
-  if (alvo->estado == MORTO){
-    muda_estado_processo(proc, PRONTO, OK);
-    ajusta_fila(self, proc);
-    console_printf("SO: desbloqueado processo %d. haha - espera", proc->process_id);
-    return;
+// habilita ou desabilita a interrupção de um terminal (dispositivo
+//   TECLADO_INT ou TELA_INT)
+static void so_liga_int_terminal(so_t *self, int dispositivo, bool liga)
+{
+  if (es_escreve(self->es, dispositivo, liga ? 1 : 0) != ERR_OK) {
+    console_log(MSG_ERRO, "SO: problema no acesso à interrupção do terminal");
+    self->erro_interno = true;
   }
 }
 
-static void so_trata_pendencias(so_t *self)
+// atende, na ordem de chegada, os pedidos que esperam para ler (razao
+//   LEITURA) ou escrever (ESCRITA) no terminal, enquanto o dispositivo estiver
+//   pronto; se nenhum continuar esperando, a interrupção correspondente é
+//   desabilitada
+static void so_atende_terminal(so_t *self, int terminal, process_r_bloq_t razao)
 {
-  for (int i = 0; i < self->qnt_processos; i++){
-    processo_t *proc = self->tabela_processos[i];
-
-    if (proc->estado == BLOQUEADO){
-      int razao = proc->razao;
-
-      switch (razao){
-        case LEITURA:
-          trata_le(self, proc);
-          break;
-        case ESCRITA:
-          trata_escreve(self, proc);
-          break;
-        case ESPERANDO_MORRER:
-          trata_espera(self, proc);
-          break;
-        
-        default:
-          break;
-      }      
+  fila_espera_t *fila = fila_do_terminal(self, terminal, razao);
+  while (fila->ini != NULL) {
+    bool atendido;
+    if (razao == LEITURA) {
+      atendido = trata_le(self, fila->ini);
+    } else {
+      atendido = trata_escreve(self, fila->ini);
     }
+    if (!atendido) break;
+  }
+  if (fila->ini == NULL) {
+    int dispositivo = (razao == LEITURA) ? TECLADO_INT(terminal) : TELA_INT(terminal);
+    so_liga_int_terminal(self, dispositivo, false);
   }
+}
+
+// desbloqueia os processos que esperavam 'proc', que morreu
+static void acorda_esperas(so_t *self, processo_t *proc){
+  while (proc->esperas.ini != NULL){
+    processo_t *espera = proc->esperas.ini;
+    sai_da_espera(espera);
+    muda_estado_processo(self, espera, PRONTO, OK);
+    espera->reg_a = 0;
+    ajusta_fila(self, espera);
+    console_log(MSG_DETALHE, "SO: desbloqueado processo %d. haha - espera", espera->process_id);
+  }
+}
 
+static void so_trata_pendencias(so_t *self)
+{
+  // nada a fazer: os processos que esperam outro morrer são desbloqueados
+  //   em mata_processo, e os que esperam o terminal na interrupção dele
 }
 
 void calcula_prioridade(so_t *self, processo_t *proc){
   if (proc == NULL) return;
-  proc->prioridade = (proc->prioridade + (QUANTUM - self->quantum) / (float)QUANTUM) / 2;
+  proc->prioridade = (proc->prioridade + (self->config.quantum - self->quantum) / (float)self->config.quantum) / 2;
+  // só a chave deste processo mudou, é reposicionado na fila de prioridade
+  fila_prio_altera(self->prontos_prio, proc->slot, chave_pronto(self, proc));
 }
 
 static void so_escalona(so_t *self){
 
   calcula_prioridade(self, self->processo_corrente);
 
-  if(ESCALONADOR >= 0 && ESCALONADOR < 3){
-    escalonadores[ESCALONADOR](self);
+  if(self->config.escalonador >= 0 && self->config.escalonador < N_ESCALONADORES){
+    escalonadores[self->config.escalonador](self);
   }
   else{
-    console_printf("SO: escalonador não implementado.");
+    console_log(MSG_ERRO, "SO: escalonador não implementado.");
     self->erro_interno = true;
   }
 }
 
 processo_t *proximo(so_t *self){
-  for (int i = 0; i < self->qnt_processos; i++){
+  for (int i = 0; i < self->n_slots; i++){
     if (self->tabela_processos[i]->estado == PRONTO){
       return self->tabela_processos[i];
     }
@@ -543,13 +1062,9 @@ processo_t *proximo(so_t *self){
   return NULL;
 }
 
+// só é chamada quando não tem processo pronto: os vivos estão todos bloqueados
 bool tem_bloqueado(so_t *self){
-  for (int i = 0; i < self->qnt_processos; i++){
-    if (self->tabela_processos[i]->estado == BLOQUEADO){
-      return true;
-    }
-  }
-  return false;
+  return self->n_vivos > 0;
 }
 
 static void so_escalona_simples(so_t *self)
@@ -590,8 +1105,8 @@ static void so_escalona_round_robin(so_t *self){
   }
 
   if (tam_fila(self) != 0) {
-    self->processo_corrente = self->fila_prontos[0];
-    self->quantum = QUANTUM;
+    self->processo_corrente = self->fila_ini;
+    self->quantum = self->config.quantum;
     return;
   }
 
@@ -604,19 +1119,6 @@ static void so_escalona_round_robin(so_t *self){
   }
 }
 
-void ordena_fila_prioridade(so_t *self){
-  processo_t *aux;
-  for (int i = 0; i < tam_fila(self); i++){
-    for (int j = i + 1; j < tam_fila(self); j++){
-      if (self->fila_prontos[i]->prioridade > self->fila_prontos[j]->prioridade){
-        aux = self->fila_prontos[i];
-        self->fila_prontos[i] = self->fila_prontos[j];
-        self->fila_prontos[j] = aux;
-      }
-    }
-  }
-}
-
 static void so_escalona_prioridade(so_t *self){
   if (self->processo_corrente != NULL && self->processo_corrente->estado == PRONTO && self->quantum > 0){
     return;
@@ -628,9 +1130,58 @@ static void so_escalona_prioridade(so_t *self){
   }
 
   if (tam_fila(self) != 0) {
-    ordena_fila_prioridade(self);
-    self->processo_corrente = self->fila_prontos[0];
-    self->quantum = QUANTUM;
+    self->processo_corrente = primeiro_pronto(self);
+    self->quantum = self->config.quantum;
+    return;
+  }
+
+  if (tem_bloqueado(self)){
+    self->processo_corrente = NULL;
+  }
+  else{
+    console_printf("SO: todos processos foram executados.");
+    self->erro_interno = true;
+  }
+}
+
+// volta todos os processos para o nível 0, para que os que desceram de nível
+//   por usar muita CPU não fiquem sem executar
+static void mlfq_boost(so_t *self){
+  for (int i = 0; i < self->n_slots; i++){
+    processo_t *proc = self->tabela_processos[i];
+    if (proc->estado == MORTO) continue;
+    proc->nivel = 0;
+    fila_prio_altera(self->prontos_prio, proc->slot, chave_pronto(self, proc));
+  }
+  self->ultimo_boost = self->relogio;
+}
+
+// escalonador de múltiplas filas com realimentação: executa o primeiro pronto
+//   do nível mais prioritário, com o quantum do nível. quem esgota o quantum
+//   desce um nível; quem bloqueia antes continua no mesmo nível. o processo
+//   corrente perde a CPU se um de nível mais prioritário ficar pronto.
+static void so_escalona_mlfq(so_t *self){
+  if (self->relogio - self->ultimo_boost >= MLFQ_PERIODO_BOOST){
+    mlfq_boost(self);
+  }
+
+  processo_t *corrente = self->processo_corrente;
+  if (corrente != NULL && corrente->estado == PRONTO){
+    // o corrente continua na fila de prontos enquanto executa
+    processo_t *primeiro = primeiro_pronto(self);
+    if (self->quantum > 0 && primeiro->nivel >= corrente->nivel){
+      return;
+    }
+    corrente->metricas.preempcoes++;
+    if (self->quantum == 0 && corrente->nivel < MLFQ_NIVEIS - 1){
+      corrente->nivel++;
+    }
+    ajusta_fila_pronto(self, corrente);
+  }
+
+  if (tam_fila(self) != 0) {
+    self->processo_corrente = primeiro_pronto(self);
+    self->quantum = mlfq_quantum[self->processo_corrente->nivel];
     return;
   }
 
@@ -643,6 +1194,19 @@ static void so_escalona_prioridade(so_t *self){
   }
 }
 
+// se o processo em execução mudou, a CPU fica ocupada pelo custo da troca
+//   antes de retornar da interrupção; esse tempo é contado nas métricas do
+//   SO e, como qualquer outro, no estado dos processos e no tempo ocioso
+//   (se não tiver processo para executar)
+static void so_troca_contexto(so_t *self, processo_t *anterior)
+{
+  if (self->processo_corrente == anterior) return;
+  self->metricas.n_trocas++;
+  if (self->config.custo_troca == 0) return;
+  cpu_ocupa(self->cpu, self->config.custo_troca);
+  self->metricas.t_troca_contexto += self->config.custo_troca;
+}
+
 static int so_despacha(so_t *self)
 {
   if (self->erro_interno) return 1;
@@ -669,6 +1233,8 @@ static void so_trata_irq_reset(so_t *self);
 static void so_trata_irq_chamada_sistema(so_t *self);
 static void so_trata_irq_err_cpu(so_t *self);
 static void so_trata_irq_relogio(so_t *self);
+static void so_trata_irq_teclado(so_t *self);
+static void so_trata_irq_tela(so_t *self);
 static void so_trata_irq_desconhecida(so_t *self, int irq);
 
 static void so_trata_irq(so_t *self, int irq)
@@ -687,6 +1253,12 @@ static void so_trata_irq(so_t *self, int irq)
     case IRQ_RELOGIO:
       so_trata_irq_relogio(self);
       break;
+    case IRQ_TECLADO:
+      so_trata_irq_teclado(self);
+      break;
+    case IRQ_TELA:
+      so_trata_irq_tela(self);
+      break;
     default:
       so_trata_irq_desconhecida(self, irq);
   }
@@ -695,11 +1267,11 @@ static void so_trata_irq(so_t *self, int irq)
 // interrupção gerada uma única vez, quando a CPU inicializa
 static void so_trata_irq_reset(so_t *self)
 {
-  // coloca o programa init na memória
-  processo_t *init = so_adiciona_processo(self, "init.maq");
+  // coloca o programa inicial (normalmente o init) na memória
+  processo_t *init = so_adiciona_processo(self, self->config.programa_inicial);
 
-  if (init->reg_pc != 100) {
-    console_printf("SO: problema na carga do programa inicial");
+  if (init == NULL) {
+    console_log(MSG_ERRO, "SO: problema na carga do programa inicial");
     self->erro_interno = true;
     return;
   }
@@ -715,7 +1287,7 @@ static void so_trata_irq_err_cpu(so_t *self)
 
   mem_le(self->mem, IRQ_END_erro, &err_int);
   err_t err = err_int;
-  console_printf("SO: IRQ não tratada -- erro na CPU: %s", err_nome(err));
+  console_log(MSG_ERRO, "SO: IRQ não tratada -- erro na CPU: %s", err_nome(err));
   self->erro_interno = true;
 }
 
@@ -725,22 +1297,52 @@ static void so_trata_irq_relogio(so_t *self)
   // rearma o interruptor do relógio e reinicializa o timer para a próxima interrupção
   err_t e1, e2;
   e1 = es_escreve(self->es, D_RELOGIO_INTERRUPCAO, 0); // desliga o sinalizador de interrupção
-  e2 = es_escreve(self->es, D_RELOGIO_TIMER, INTERVALO_INTERRUPCAO);
+  e2 = es_escreve(self->es, D_RELOGIO_TIMER, self->config.intervalo_interrupcao);
   if (e1 != ERR_OK || e2 != ERR_OK) {
-    console_printf("SO: problema da reinicialização do timer");
+    console_log(MSG_ERRO, "SO: problema da reinicialização do timer");
     self->erro_interno = true;
   }
 
   if (self->quantum > 0){
     self->quantum--;
   }
-  console_printf("SO: quantum do processo: %d", self->quantum);
+  console_log(MSG_DETALHE, "SO: quantum do processo: %d", self->quantum);
+}
+
+// interrupção gerada quando algum teclado com a interrupção habilitada tem
+//   caractere para ser lido
+static void so_trata_irq_teclado(so_t *self)
+{
+  for (int terminal = TERMINAL_A; terminal <= TERMINAL_D; terminal += 4) {
+    int pedindo;
+    if (es_le(self->es, TECLADO_INT(terminal), &pedindo) != ERR_OK) {
+      console_log(MSG_ERRO, "SO: problema no acesso à interrupção do teclado");
+      self->erro_interno = true;
+      return;
+    }
+    if (pedindo != 0) so_atende_terminal(self, terminal, LEITURA);
+  }
+}
+
+// interrupção gerada quando alguma tela com a interrupção habilitada pode
+//   receber um caractere
+static void so_trata_irq_tela(so_t *self)
+{
+  for (int terminal = TERMINAL_A; terminal <= TERMINAL_D; terminal += 4) {
+    int pedindo;
+    if (es_le(self->es, TELA_INT(terminal), &pedindo) != ERR_OK) {
+      console_log(MSG_ERRO, "SO: problema no acesso à interrupção da tela");
+      self->erro_interno = true;
+      return;
+    }
+    if (pedindo != 0) so_atende_terminal(self, terminal, ESCRITA);
+  }
 }
 
 // foi gerada uma interrupção para a qual o SO não está preparado
 static void so_trata_irq_desconhecida(so_t *self, int irq)
 {
-  console_printf("SO: não sei tratar IRQ %d (%s)", irq, irq_nome(irq));
+  console_log(MSG_ERRO, "SO: não sei tratar IRQ %d (%s)", irq, irq_nome(irq));
   self->erro_interno = true;
 }
 
@@ -759,11 +1361,11 @@ static void so_trata_irq_chamada_sistema(so_t *self)
 {
   int id_chamada;
   if (mem_le(self->mem, IRQ_END_A, &id_chamada) != ERR_OK) {
-    console_printf("SO: erro no acesso ao id da chamada de sistema");
+    console_log(MSG_ERRO, "SO: erro no acesso ao id da chamada de sistema");
     self->erro_interno = true;
     return;
   }
-  console_printf("SO: chamada de sistema %d", id_chamada);
+  console_log(MSG_DETALHE, "SO: chamada de sistema %d", id_chamada);
   switch (id_chamada) {
     case SO_LE:
       so_chamada_le(self);
@@ -781,7 +1383,7 @@ static void so_trata_irq_chamada_sistema(so_t *self)
       so_chamada_espera_proc(self);
       break;
     default:
-      console_printf("SO: chamada de sistema desconhecida (%d)", id_chamada);
+      console_log(MSG_ERRO, "SO: chamada de sistema desconhecida (%d)", id_chamada);
       self->erro_interno = true;
   }
 }
@@ -790,24 +1392,29 @@ static void so_trata_irq_chamada_sistema(so_t *self)
 static void so_chamada_le(so_t *self)
 {
   int terminal = self->processo_corrente->terminal;
+  fila_espera_t *fila = fila_do_terminal(self, terminal, LEITURA);
 
   int estado;
   if (es_le(self->es, terminal_processo(terminal, TECLADO_OK), &estado) != ERR_OK) {
-    console_printf("SO: problema no acesso ao estado do teclado");
+    console_log(MSG_ERRO, "SO: problema no acesso ao estado do teclado");
     self->erro_interno = true;
     return;
   }
-  if (estado == 0){
-    console_printf("SO: teclado não disponível");
-    muda_estado_processo(self->processo_corrente, BLOQUEADO, LEITURA);
+  // se já tem pedido esperando, este vai para o fim da fila
+  if (estado == 0 || fila->ini != NULL){
+    console_log(MSG_DETALHE, "SO: teclado não disponível");
+    muda_estado_processo(self, self->processo_corrente, BLOQUEADO, LEITURA);
+    entra_na_espera(self->processo_corrente, fila);
     calcula_prioridade(self, self->processo_corrente);
     remove_fila(self, self->processo_corrente->process_id);
+    // o processo é desbloqueado na interrupção do terminal
+    so_liga_int_terminal(self, TECLADO_INT(terminal), true);
     return;
   }
 
   int dado;
   if (es_le(self->es, terminal_processo(terminal, TECLADO), &dado) != ERR_OK) {
-    console_printf("SO: problema no acesso ao teclado");
+    console_log(MSG_ERRO, "SO: problema no acesso ao teclado");
     self->erro_interno = true;
     return;
   }
@@ -819,20 +1426,26 @@ static void so_chamada_le(so_t *self)
 static void so_chamada_escr(so_t *self)
 {
   int terminal = self->processo_corrente->terminal;
+  fila_espera_t *fila = fila_do_terminal(self, terminal, ESCRITA);
 
  
   int estado;
 
   if (es_le(self->es, terminal_processo(terminal, TELA_OK), &estado) != ERR_OK) {
-    console_printf("SO: problema no acesso ao estado da tela");
+    console_log(MSG_ERRO, "SO: problema no acesso ao estado da tela");
     self->erro_interno = true;
     return;
   }
-  if (estado == 0){
-    console_printf("SO: tela não disponível");
-    muda_estado_processo(self->processo_corrente, BLOQUEADO, ESCRITA);
+  // se já tem pedido esperando, este vai para o fim da fila
+  if (estado == 0 || fila->ini != NULL){
+    console_log(MSG_DETALHE, "SO: tela não disponível");
+    muda_estado_processo(self, self->processo_corrente, BLOQUEADO, ESCRITA);
+    self->processo_corrente->dado_escrita = self->processo_corrente->reg_x;
+    entra_na_espera(self->processo_corrente, fila);
     calcula_prioridade(self, self->processo_corrente);
     remove_fila(self, self->processo_corrente->process_id);
+    // o processo é desbloqueado na interrupção do terminal
+    so_liga_int_terminal(self, TELA_INT(terminal), true);
     return;
   }
   else {
@@ -840,7 +1453,7 @@ static void so_chamada_escr(so_t *self)
 
     mem_le(self->mem, IRQ_END_X, &dado);
     if (es_escreve(self->es, terminal_processo(terminal, TELA), dado) != ERR_OK) {
-      console_printf("SO: problema no acesso à tela");
+      console_log(MSG_ERRO, "SO: problema no acesso à tela");
       self->erro_interno = true;
       return;
     }
@@ -908,20 +1521,22 @@ static void so_chamada_espera_proc(so_t *self)
   int id_alvo = proc->reg_x;
 
   processo_t *alvo = busca_processo(self, id_alvo);
+  bool morto = processo_morto(self, id_alvo);
 
-  if (alvo == NULL || alvo == proc){
+  if ((alvo == NULL && !morto) || alvo == proc){
     proc->reg_a = -1;
     return;
   }
 
-  if (alvo->estado != MORTO){
-    muda_estado_processo(proc, BLOQUEADO, ESPERANDO_MORRER);
+  if (!morto){
+    muda_estado_processo(self, proc, BLOQUEADO, ESPERANDO_MORRER);
+    entra_na_espera(proc, &alvo->esperas);
     calcula_prioridade(self, proc);
     remove_fila(self, proc->process_id);
     return;
   }
 
-  muda_estado_processo(proc, PRONTO, OK);
+  muda_estado_processo(self, proc, PRONTO, OK);
   proc->reg_a = 0;
 }
 
@@ -933,7 +1548,7 @@ static int so_carrega_programa(so_t *self, char *nome_do_executavel)
   // programa para executar na nossa CPU
   programa_t *prog = prog_cria(nome_do_executavel);
   if (prog == NULL) {
-    console_printf("Erro na leitura do programa '%s'\n", nome_do_executavel);
+    console_log(MSG_ERRO, "Erro na leitura do programa '%s'\n", nome_do_executavel);
     return -1;
   }
 
@@ -942,7 +1557,7 @@ static int so_carrega_programa(so_t *self, char *nome_do_executavel)
 
   for (int end = end_ini; end < end_fim; end++) {
     if (mem_escreve(self->mem, end, prog_dado(prog, end)) != ERR_OK) {
-      console_printf("Erro na carga da memória, endereco %d\n", end);
+      console_log(MSG_ERRO, "Erro na carga da memória, endereco %d\n", end);
       return -1;
     }
   }
@@ -9,6 +9,36 @@
 
 #include <curses.h>
 #include <locale.h>
+#include <stdbool.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+// intervalo mínimo entre verificações do teclado, em ms
+// tela_tecla é chamada a cada volta do laço do controle, que pode ser a cada
+//   instrução; uma chamada ao sistema por instrução custa caro, e o operador
+//   não digita tão rápido
+#define INTERVALO_TECLADO 10
+
+// instante da última verificação do teclado, em ms
+static long ultima_verificacao = 0;
+// se a última leitura pegou uma tecla -- o curses pode ter guardado mais
+//   caracteres do que devolveu, e esses não aparecem no poll
+static bool pode_ter_mais = false;
+
+static long agora_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+// retorna true se tem algo para ler na entrada, esperando até 'ms' ms
+static bool tem_entrada(int ms)
+{
+  struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+  return poll(&pfd, 1, ms) > 0;
+}
 
 void tela_init(void)
 {
@@ -16,7 +46,7 @@ void tela_init(void)
   initscr();     // inicializa o curses
   cbreak();      // lê cada char, não espera enter
   noecho();      // não mostra o que é digitado
-  timeout(5);    // não espera digitar, retorna ERR se nada foi digitado
+  nodelay(stdscr, TRUE);  // não espera digitar, retorna ERR se nada foi digitado
   // inicializa algumas cores
   start_color();
   init_pair(COR_TXT_PAR,      COLOR_GREEN,  COLOR_BLACK );
@@ -35,11 +65,6 @@ void tela_fim()
   endwin();
 }
 
-void tela_espera(int ms)
-{
-  timeout(ms);
-}
-
 void tela_posiciona(int lin, int col)
 {
   move(lin, col);
@@ -58,11 +83,23 @@ void tela_limpa_linha()
 
 char tela_tecla(void)
 {
+  if (!pode_ter_mais) {
+    long agora = agora_ms();
+    if (agora - ultima_verificacao < INTERVALO_TECLADO) return 0;
+    ultima_verificacao = agora;
+    if (!tem_entrada(0)) return 0;
+  }
   int ch = getch();
+  pode_ter_mais = (ch != ERR);
   if (ch == ERR) return 0;
   return ch;
 }
 
+void tela_espera_tecla(int ms)
+{
+  if (!pode_ter_mais) pode_ter_mais = tem_entrada(ms);
+}
+
 void tela_atualiza()
 {
   refresh();
@@ -0,0 +1,285 @@
+// varredura.c
+// varredura de parâmetros do SO
+// simulador de computador
+// so24b
+
+// executa o simulador (./main, em modo lote) para cada combinação de
+//   escalonador, quantum, intervalo entre interrupções do relógio e carga de
+//   trabalho (programa do processo inicial), e junta as métricas de todas as
+//   execuções em um arquivo CSV.
+// as execuções são independentes, cada uma é um processo do sistema
+//   hospedeiro, executando em um diretório temporário próprio (onde ficam os
+//   logs dos terminais e o arquivo de métricas), e várias são executadas ao
+//   mesmo tempo, uma por núcleo do hospedeiro.
+// cada execução gera suas métricas em CSV (opção -f csv do simulador), e o
+//   CSV da varredura é a junção delas, com as colunas da grade na frente:
+//   escalonador,quantum,intervalo,carga,instante,processo,metrica,item,valor
+//   (as colunas a partir de instante são as do simulador, ver so.c), que é a
+//   forma mais fácil de filtrar ou transformar em tabela numa planilha.
+// o alvo varredura do Makefile compila e executa com os valores padrão
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define MAX_VALORES 20
+
+// uma lista de valores de um parâmetro, lida de uma opção como "0,1,2"
+typedef struct {
+  char *valores[MAX_VALORES];
+  int n;
+} lista_t;
+
+// uma execução do simulador
+typedef struct {
+  char *escalonador;
+  char *quantum;
+  char *intervalo;
+  char *carga;
+  // diretório temporário da execução
+  char dir[100];
+  pid_t pid;
+  bool ok;
+} execucao_t;
+
+static void erro_nos_args(char *nome_do_programa, char *msg, char *arg)
+{
+  fprintf(stderr, "ERRO: %s '%s'\n", msg, arg);
+  fprintf(stderr, "chame como '%s [-e lista] [-q lista] [-t lista] [-p lista]"
+                  " [-j n] [-m max_instr] [-o arq]'\n", nome_do_programa);
+  fprintf(stderr, "  -e lista     escalonadores (padrão 0,1,2,3)\n");
+  fprintf(stderr, "  -q lista     quanta (padrão 2,5,10)\n");
+  fprintf(stderr, "  -t lista     intervalos do relógio (padrão 25,50,100)\n");
+  fprintf(stderr, "  -p lista     programas iniciais (padrão init.maq,p1.maq,p2.maq,p3.maq)\n");
+  fprintf(stderr, "  -j n         execuções simultâneas (padrão, uma por núcleo)\n");
+  fprintf(stderr, "  -m max_instr limite de instruções de cada execução (padrão 10000000)\n");
+  fprintf(stderr, "  -o arq       arquivo CSV gerado (padrão, a saída padrão)\n");
+  fprintf(stderr, "  listas são valores separados por vírgula\n");
+  exit(1);
+}
+
+// separa os valores de 'str' (que é alterada) na lista
+static void separa_lista(char *str, lista_t *lista)
+{
+  lista->n = 0;
+  for (char *valor = strtok(str, ","); valor != NULL; valor = strtok(NULL, ",")) {
+    if (lista->n == MAX_VALORES) break;
+    lista->valores[lista->n++] = valor;
+  }
+}
+
+// cria o diretório temporário da execução, com links para os programas (.maq)
+//   do diretório corrente
+static bool prepara_dir(execucao_t *exec, char *dir_corrente)
+{
+  strcpy(exec->dir, "/tmp/varredura.XXXXXX");
+  if (mkdtemp(exec->dir) == NULL) return false;
+  DIR *dir = opendir(dir_corrente);
+  if (dir == NULL) return false;
+  struct dirent *ent;
+  while ((ent = readdir(dir)) != NULL) {
+    char *ext = strrchr(ent->d_name, '.');
+    if (ext == NULL || strcmp(ext, ".maq") != 0) continue;
+    char origem[PATH_MAX + NAME_MAX + 2], destino[PATH_MAX];
+    snprintf(origem, sizeof(origem), "%s/%s", dir_corrente, ent->d_name);
+    snprintf(destino, sizeof(destino), "%s/%s", exec->dir, ent->d_name);
+    if (symlink(origem, destino) != 0) {
+      closedir(dir);
+      return false;
+    }
+  }
+  closedir(dir);
+  return true;
+}
+
+// apaga o diretório temporário da execução e o que tem nele
+static void apaga_dir(execucao_t *exec)
+{
+  DIR *dir = opendir(exec->dir);
+  if (dir == NULL) return;
+  struct dirent *ent;
+  while ((ent = readdir(dir)) != NULL) {
+    if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
+    char nome[PATH_MAX];
+    snprintf(nome, sizeof(nome), "%s/%s", exec->dir, ent->d_name);
+    unlink(nome);
+  }
+  closedir(dir);
+  rmdir(exec->dir);
+}
+
+// inicia a execução do simulador, em um processo filho
+static void inicia(execucao_t *exec, char *simulador, char *max_instr)
+{
+  exec->pid = fork();
+  if (exec->pid < 0) {
+    perror("fork");
+    exit(1);
+  }
+  if (exec->pid > 0) return;
+  // processo filho: executa o simulador no diretório da execução
+  if (chdir(exec->dir) != 0) _exit(1);
+  int nulo = open("/dev/null", O_WRONLY);
+  dup2(nulo, STDOUT_FILENO);
+  dup2(nulo, STDERR_FILENO);
+  execl(simulador, "main", "-l", "-m", max_instr,
+        "-e", exec->escalonador, "-q", exec->quantum, "-t", exec->intervalo,
+        "-p", exec->carga, "-f", "csv", "-o", "metricas.csv", (char *)NULL);
+  _exit(1);
+}
+
+// copia as métricas da execução para o CSV
+// o arquivo de métricas já é CSV; cada linha depois do cabeçalho é copiada
+//   como está, precedida dos valores da grade
+static void junta_metricas(execucao_t *exec, FILE *csv)
+{
+  char nome[PATH_MAX];
+  snprintf(nome, sizeof(nome), "%s/metricas.csv", exec->dir);
+  FILE *arq = fopen(nome, "r");
+  if (arq == NULL) {
+    exec->ok = false;
+    return;
+  }
+  char linha[400];
+  bool cabecalho = true;
+  while (fgets(linha, sizeof(linha), arq) != NULL) {
+    linha[strcspn(linha, "\n")] = '\0';
+    if (cabecalho || linha[0] == '\0') {
+      cabecalho = false;
+      continue;
+    }
+    fprintf(csv, "%s,%s,%s,%s,%s\n", exec->escalonador, exec->quantum,
+            exec->intervalo, exec->carga, linha);
+  }
+  fclose(arq);
+}
+
+int main(int argc, char *argv[argc])
+{
+  char padrao_e[] = "0,1,2,3";
+  char padrao_q[] = "2,5,10";
+  char padrao_t[] = "25,50,100";
+  char padrao_p[] = "init.maq,p1.maq,p2.maq,p3.maq";
+  char *str_e = padrao_e, *str_q = padrao_q, *str_t = padrao_t, *str_p = padrao_p;
+  char *max_instr = "10000000";
+  char *nome_csv = NULL;
+  long n_simultaneas = sysconf(_SC_NPROCESSORS_ONLN);
+
+  for (int argi = 1; argi < argc; argi++) {
+    char *arg = argv[argi];
+    if (arg[0] != '-' || arg[1] == '\0' || arg[2] != '\0') {
+      erro_nos_args(argv[0], "argumento desconhecido:", arg);
+    }
+    if (argi + 1 >= argc) erro_nos_args(argv[0], "falta valor após", arg);
+    char *valor = argv[++argi];
+    switch (arg[1]) {
+      case 'e': str_e = valor; break;
+      case 'q': str_q = valor; break;
+      case 't': str_t = valor; break;
+      case 'p': str_p = valor; break;
+      case 'm': max_instr = valor; break;
+      case 'o': nome_csv = valor; break;
+      case 'j':
+        n_simultaneas = atol(valor);
+        if (n_simultaneas <= 0) erro_nos_args(argv[0], "valor inválido:", valor);
+        break;
+      default:
+        erro_nos_args(argv[0], "argumento desconhecido:", arg);
+    }
+  }
+  if (n_simultaneas <= 0) n_simultaneas = 1;
+
+  lista_t escalonadores, quanta, intervalos, cargas;
+  separa_lista(str_e, &escalonadores);
+  separa_lista(str_q, &quanta);
+  separa_lista(str_t, &intervalos);
+  separa_lista(str_p, &cargas);
+
+  // o simulador e os programas estão no diretório corrente
+  char dir_corrente[PATH_MAX];
+  if (getcwd(dir_corrente, sizeof(dir_corrente)) == NULL) {
+    perror("getcwd");
+    return 1;
+  }
+  char simulador[PATH_MAX + 10];
+  snprintf(simulador, sizeof(simulador), "%s/main", dir_corrente);
+
+  // monta a grade de execuções
+  int n_exec = escalonadores.n * quanta.n * intervalos.n * cargas.n;
+  execucao_t *execs = calloc(n_exec, sizeof(*execs));
+  int i = 0;
+  for (int e = 0; e < escalonadores.n; e++) {
+    for (int q = 0; q < quanta.n; q++) {
+      for (int t = 0; t < intervalos.n; t++) {
+        for (int p = 0; p < cargas.n; p++) {
+          execs[i].escalonador = escalonadores.valores[e];
+          execs[i].quantum = quanta.valores[q];
+          execs[i].intervalo = intervalos.valores[t];
+          execs[i].carga = cargas.valores[p];
+          i++;
+        }
+      }
+    }
+  }
+
+  // executa, com no máximo n_simultaneas ao mesmo tempo
+  bool mostra_progresso = isatty(STDERR_FILENO);
+  int proxima = 0;
+  int executando = 0;
+  int terminadas = 0;
+  while (terminadas < n_exec) {
+    while (executando < n_simultaneas && proxima < n_exec) {
+      execucao_t *exec = &execs[proxima++];
+      if (!prepara_dir(exec, dir_corrente)) {
+        fprintf(stderr, "ERRO: problema na criação de '%s'\n", exec->dir);
+        return 1;
+      }
+      inicia(exec, simulador, max_instr);
+      executando++;
+    }
+    int status;
+    pid_t pid = wait(&status);
+    if (pid < 0) break;
+    for (int j = 0; j < n_exec; j++) {
+      if (execs[j].pid != pid) continue;
+      execs[j].ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+      break;
+    }
+    executando--;
+    terminadas++;
+    if (mostra_progresso) fprintf(stderr, "\r%d/%d execuções", terminadas, n_exec);
+  }
+  if (mostra_progresso) fprintf(stderr, "\n");
+
+  // junta as métricas, na ordem da grade
+  FILE *csv = stdout;
+  if (nome_csv != NULL) {
+    csv = fopen(nome_csv, "w");
+    if (csv == NULL) {
+      fprintf(stderr, "ERRO: problema na abertura de '%s'\n", nome_csv);
+      return 1;
+    }
+  }
+  fprintf(csv, "escalonador,quantum,intervalo,carga,"
+               "instante,processo,metrica,item,valor\n");
+  int n_erros = 0;
+  for (i = 0; i < n_exec; i++) {
+    execucao_t *exec = &execs[i];
+    if (exec->ok) junta_metricas(exec, csv);
+    if (!exec->ok) {
+      fprintf(stderr, "ERRO: execução com -e %s -q %s -t %s -p %s falhou\n",
+              exec->escalonador, exec->quantum, exec->intervalo, exec->carga);
+      n_erros++;
+    }
+    apaga_dir(exec);
+  }
+  if (csv != stdout) fclose(csv);
+  free(execs);
+  return n_erros == 0 ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+// agenda.h
+// agenda de eventos no tempo simulado
+// simulador de computador
+// so24b
+
+#ifndef AGENDA_H
+#define AGENDA_H
+
+// agenda de eventos dos dispositivos
+//
+// um dispositivo que tem que fazer alguma coisa daqui a um certo tempo (o
+//   relógio que chega ao fim da contagem, o disco que termina uma
+//   transferência, o terminal que rola a linha) programa um evento na agenda,
+//   em vez de ser chamado a cada unidade de tempo para ver se chegou a hora.
+//   quem controla a passagem do tempo avança a agenda, e a função do evento é
+//   chamada quando ele vence.
+//
+// é implementada com uma roda de temporização hierárquica: N_NIVEIS níveis de
+//   64 posições, o nível 0 com uma posição para cada unidade de tempo, o
+//   nível 1 uma para cada 64 unidades, o 2 para cada 64*64, etc. um evento
+//   fica no nível mais baixo que alcança o seu instante, e desce de nível
+//   quando o tempo chega ao trecho da sua posição.
+// programar e cancelar um evento são O(1); avançar o tempo só dá trabalho
+//   quando vence um evento ou um trecho tem que descer de nível.
+
+#include <stdbool.h>
+
+typedef struct agenda_t agenda_t;
+
+// função chamada quando o evento vence, com o argumento definido na
+//   inicialização do evento
+typedef void (*f_evento_t)(void *arg);
+
+// um evento -- é alocado por quem usa (normalmente dentro da estrutura do
+//   dispositivo), e pode ser programado de novo depois de vencer
+// os campos são de uso interno da agenda
+typedef struct evento_t evento_t;
+struct evento_t {
+  f_evento_t funcao;
+  void *arg;
+  // instante em que vence, se estiver programado
+  long quando;
+  bool programado;
+  // encadeamento na posição da agenda
+  evento_t *ant;
+  evento_t *prox;
+};
+
+// cria uma agenda vazia, no instante 0
+agenda_t *agenda_cria(void);
+
+// destrói uma agenda
+// os eventos programados não são chamados
+void agenda_destroi(agenda_t *self);
+
+// inicializa um evento não programado, que chama 'funcao' com 'arg'
+void evento_inicializa(evento_t *evento, f_evento_t funcao, void *arg);
+
+// retorna true se o evento está programado
+bool evento_programado(evento_t *evento);
+
+// programa o evento para vencer daqui a 'atraso' unidades de tempo (pelo
+//   menos 1); se ele já estava programado, o instante anterior é esquecido
+void agenda_programa(agenda_t *self, evento_t *evento, int atraso);
+
+// cancela o evento, se estiver programado
+void agenda_cancela(agenda_t *self, evento_t *evento);
+
+// retorna quanto tempo falta para o evento vencer (0 se não está programado)
+int agenda_tempo_ate(agenda_t *self, evento_t *evento);
+
+// retorna quanto tempo falta para o próximo evento vencer (-1 se não tem
+//   evento programado)
+int agenda_tempo_ate_proximo(agenda_t *self);
+
+// avança o tempo em 'n' unidades, chamando as funções dos eventos que
+//   vencerem, em ordem de instante (a ordem entre os que vencem no mesmo
+//   instante não é definida)
+// as funções podem programar e cancelar eventos
+void agenda_avanca(agenda_t *self, int n);
+
+#endif // AGENDA_H
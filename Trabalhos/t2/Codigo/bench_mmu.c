@@ -0,0 +1,101 @@
+// bench_mmu.c
+// mede o custo da tradução de endereços pela MMU
+// simulador de computador
+// so24b
+
+// faz acessos de leitura e escrita em modo usuário através da MMU, com a
+//   configuração de página com que foi compilado (ver TAM_PAGINA e BITS_PAGINA
+//   em mmu.h), e imprime o tempo médio por acesso
+// o alvo bench_mmu do Makefile compila e executa com página de 16 palavras,
+//   uma vez com divisão e resto (PAGINA_POR_DIVISAO) e outra com deslocamento
+//   e máscara, para que a TLB se comporte igual nas duas; e também com a
+//   página de 10 palavras do padrão
+// cada medida é repetida algumas vezes e vale a menor, que é a menos
+//   perturbada pelo resto da máquina
+
+#include "mmu.h"
+#include "tabpag.h"
+#include "memoria.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MEM_TAM 100000         // tamanho da memória física
+#define TAM_REGIAO 4000        // tamanho da região virtual acessada
+#define N_PASSADAS 5000        // quantas vezes a região é percorrida
+#define N_REPETICOES 5         // quantas vezes cada medida é feita
+
+// para o compilador não descartar os acessos
+static volatile int sumidouro;
+
+// percorre a região, 'passo' endereços por vez; retorna o tempo em ns por acesso
+static double mede_1(mmu_t *mmu, int passo)
+{
+  long n_acessos = 0;
+  int soma = 0;
+  clock_t ini = clock();
+  for (int passada = 0; passada < N_PASSADAS; passada++) {
+    for (int inicio = 0; inicio < passo; inicio++) {
+      for (int end = inicio; end < TAM_REGIAO; end += passo) {
+        int valor;
+        mmu_le(mmu, end, &valor, usuario);
+        mmu_escreve(mmu, end, valor + 1, usuario);
+        soma += valor;
+        n_acessos += 2;
+      }
+    }
+  }
+  clock_t fim = clock();
+  sumidouro = soma;
+  return (double)(fim - ini) / CLOCKS_PER_SEC * 1e9 / n_acessos;
+}
+
+// a menor de N_REPETICOES medidas
+static double mede(mmu_t *mmu, int passo)
+{
+  double menor = mede_1(mmu, passo);
+  for (int i = 1; i < N_REPETICOES; i++) {
+    double t = mede_1(mmu, passo);
+    if (t < menor) menor = t;
+  }
+  return menor;
+}
+
+int main(void)
+{
+  mem_t *mem = mem_cria(MEM_TAM);
+  mmu_t *mmu = mmu_cria(mem);
+  tabpag_t *tabpag = tabpag_cria();
+
+  // mapeia as páginas da região em quadros espalhados pela memória
+  int n_paginas = (TAM_REGIAO + TAM_PAGINA - 1) / TAM_PAGINA;
+  int n_quadros = MEM_TAM / TAM_PAGINA;
+  for (int pagina = 0; pagina < n_paginas; pagina++) {
+    tabpag_define_quadro(tabpag, pagina, (pagina * 7) % n_quadros);
+  }
+  mmu_define_tabpag(mmu, tabpag);
+
+  // sequencial: quase tudo acerta na TLB
+  // um acesso por página: quase tudo erra na TLB
+  double seq = mede(mmu, 1);
+  double pag = mede(mmu, TAM_PAGINA);
+  long acertos, falhas;
+  mmu_tlb_estatisticas(mmu, &acertos, &falhas);
+
+  printf("página de %d palavras (%s), TLB de %d entradas\n", TAM_PAGINA,
+#if defined(BITS_PAGINA) && !defined(PAGINA_POR_DIVISAO)
+         "deslocamento e máscara",
+#else
+         "divisão e resto",
+#endif
+         TAM_TLB);
+  printf("  acesso sequencial:   %6.2f ns por acesso\n", seq);
+  printf("  acesso por página:   %6.2f ns por acesso\n", pag);
+  printf("  TLB: %ld acertos, %ld falhas\n", acertos, falhas);
+
+  mmu_destroi(mmu);
+  tabpag_destroi(tabpag);
+  mem_destroi(mem);
+  return 0;
+}
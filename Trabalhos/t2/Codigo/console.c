@@ -8,12 +8,14 @@
 #include "console.h"
 #include "terminal.h"
 #include "tela.h"
+#include "agenda.h"
 
 #include <string.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <time.h>
 #include <assert.h>
 
 // CONSTANTES {{{1
@@ -39,6 +41,13 @@
 // números de comandos para o controlador que podem ser guardados na console
 #define N_CMD_EXT 10
 
+// tamanho do buffer do arquivo de log -- o SO escreve muito na console
+#define TAM_BUFFER_LOG (64 * 1024)
+
+// a tela é redesenhada no máximo esse número de vezes por segundo
+#define QUADROS_POR_SEGUNDO 30
+#define INTERVALO_DESENHO   (1000 / QUADROS_POR_SEGUNDO)  // em ms
+
 // DECLARAÇÃO {{{1
 
 struct console_t {
@@ -46,23 +55,48 @@ struct console_t {
   int cor_txt[N_TERM];
   int cor_cursor[N_TERM];
   char txt_status[N_COL+1];
+  // as linhas da console formam um buffer circular; uma linha nova
+  //   substitui a mais antiga, que está em 'lin_console'
   char txt_console[N_LIN_CONSOLE][N_COL+1];
+  int lin_console;
   char txt_entrada[N_COL+1];
   char fila_de_comandos_externos[N_CMD_EXT];
   FILE *arquivo_de_log;
+  // mensagens de nível acima desse não são mostradas (ver console_log)
+  nivel_msg_t nivel;
+  // se false, não usa o terminal físico (modo lote)
+  bool usa_tela;
+  // ms a esperar a cada instrução executada (comando D)
+  int espera_instrucao;
+  // arquivos de onde vem a entrada de cada terminal (NULL se não tiver)
+  FILE *arquivo_entrada[N_TERM];
+  // arquivos para onde vai a saída de cada terminal, quando não tem tela
+  FILE *arquivo_saida[N_TERM];
+  // eventos dos terminais; é separada da agenda do controle porque avança
+  //   em console_tictac_terminais, depois de o controle repassar as
+  //   interrupções à CPU
+  agenda_t *agenda;
+  // o que está desenhado em cada linha da tela, para só redesenhar as
+  //   linhas que mudaram
+  char txt_na_tela[N_LIN][N_COL+1];
+  // instante do último desenho, em ms
+  long t_desenho;
 };
 
 // CRIAÇÃO {{{1
 
 static console_t *console_global; // gambiarra para simplificar o uso de prints na console
-console_t *console_cria(void)
+console_t *console_cria(bool usa_tela)
 {
   console_t *self = malloc(sizeof(*self));
   assert(self != NULL);
   console_global = self;
+  self->usa_tela = usa_tela;
+  self->espera_instrucao = 0;
+  self->agenda = agenda_cria();
 
   for (int t = 0; t < N_TERM; t++) {
-    self->term[t] = terminal_cria(N_COL);
+    self->term[t] = terminal_cria(N_COL, self->agenda);
     if ((t % 2) == 0) {
       self->cor_txt[t] = COR_TXT_PAR;
       self->cor_cursor[t] = COR_CURSOR_PAR;
@@ -70,15 +104,34 @@ console_t *console_cria(void)
       self->cor_txt[t] = COR_TXT_IMPAR;
       self->cor_cursor[t] = COR_CURSOR_IMPAR;
     }
+    self->arquivo_entrada[t] = NULL;
+    self->arquivo_saida[t] = NULL;
+    if (!usa_tela) {
+      char nome[30];
+      sprintf(nome, "log_do_terminal_%c", 'A' + t);
+      self->arquivo_saida[t] = fopen(nome, "w");
+      terminal_define_arquivo_saida(self->term[t], self->arquivo_saida[t]);
+    }
   }
   for (int l = 0; l < N_LIN_CONSOLE; l++) {
     strcpy(self->txt_console[l], "");
   }
+  self->lin_console = 0;
   strcpy(self->txt_entrada, "");
+  // nenhum texto começa com esse caractere, todas as linhas são desenhadas
+  //   na primeira vez
+  for (int l = 0; l < N_LIN; l++) {
+    strcpy(self->txt_na_tela[l], "\x01");
+  }
+  self->t_desenho = 0;
   self->fila_de_comandos_externos[0] = '\0';
   self->arquivo_de_log = fopen("log_da_console", "w");
+  if (self->arquivo_de_log != NULL) {
+    setvbuf(self->arquivo_de_log, NULL, _IOFBF, TAM_BUFFER_LOG);
+  }
+  self->nivel = MSG_DETALHE;
 
-  tela_init();
+  if (usa_tela) tela_init();
 
   return self;
 }
@@ -89,16 +142,21 @@ void console_destroi(console_t *self)
 {
   console_desenha(self);
   if (self->arquivo_de_log != NULL) fclose(self->arquivo_de_log);
-  tela_puts(COR_OCUPADO, "  digite ENTER para sair  ");
-  tela_atualiza();
-  while (tela_tecla() != '\n') {
-    ;
+  if (self->usa_tela) {
+    tela_puts(COR_OCUPADO, "  digite ENTER para sair  ");
+    tela_atualiza();
+    while (tela_tecla() != '\n') {
+      tela_espera_tecla(100);
+    }
+    tela_fim();
   }
-  tela_fim();
 
   for (int t = 0; t < N_TERM; t++) {
     terminal_destroi(self->term[t]);
+    if (self->arquivo_entrada[t] != NULL) fclose(self->arquivo_entrada[t]);
+    if (self->arquivo_saida[t] != NULL) fclose(self->arquivo_saida[t]);
   }
+  agenda_destroi(self->agenda);
   free(self);
   return;
 }
@@ -112,11 +170,44 @@ terminal_t *console_terminal(console_t *self, char id_terminal)
   return self->term[num_terminal];
 }
 
-static void atualiza_terminais(console_t *self)
+bool console_define_entrada(console_t *self, char id_terminal, char *nome_arquivo)
+{
+  int num_terminal = tolower(id_terminal) - 'a';
+  if (num_terminal < 0 || num_terminal >= N_TERM) return false;
+  FILE *arq = fopen(nome_arquivo, "r");
+  if (arq == NULL) return false;
+  if (self->arquivo_entrada[num_terminal] != NULL) {
+    fclose(self->arquivo_entrada[num_terminal]);
+  }
+  self->arquivo_entrada[num_terminal] = arq;
+  return true;
+}
+
+// passa para o terminal os caracteres do arquivo de entrada que couberem
+static void le_arquivo_de_entrada(console_t *self, int t)
+{
+  FILE *arq = self->arquivo_entrada[t];
+  while (!terminal_entrada_cheia(self->term[t])) {
+    int ch = fgetc(arq);
+    if (ch == EOF) {
+      fclose(arq);
+      self->arquivo_entrada[t] = NULL;
+      return;
+    }
+    terminal_insere_char(self->term[t], ch);
+  }
+}
+
+// passa para os terminais a entrada dos arquivos, e avança 'n' unidades de
+//   tempo na agenda dos terminais
+// a entrada só muda na primeira vez, porque ninguém consome os caracteres
+//   do terminal enquanto isso
+static void atualiza_terminais(console_t *self, int n)
 {
   for (int t = 0; t < N_TERM; t++) {
-    terminal_tictac(self->term[t]);
+    if (self->arquivo_entrada[t] != NULL) le_arquivo_de_entrada(self, t);
   }
+  agenda_avanca(self->agenda, n);
 }
 
 static void insere_string_no_terminal(console_t *self, char id_terminal, char *str)
@@ -149,14 +240,14 @@ static void limpa_saida_do_terminal(console_t *self, char id_terminal)
 
 static void insere_string_na_console(console_t *self, char *s)
 {
-  for(int l=0; l<N_LIN_CONSOLE-1; l++) {
-    strncpy(self->txt_console[l], self->txt_console[l+1], N_COL);
-    self->txt_console[l][N_COL] = '\0'; // quem definiu strncpy é estúpido!
-  }
-  strncpy(self->txt_console[N_LIN_CONSOLE-1], s, N_COL);
-  self->txt_console[N_LIN_CONSOLE-1][N_COL] = '\0'; // grrrr
+  // a linha nova fica no lugar da mais antiga
+  char *linha = self->txt_console[self->lin_console];
+  strncpy(linha, s, N_COL);
+  linha[N_COL] = '\0'; // quem definiu strncpy é estúpido!
+  self->lin_console = (self->lin_console + 1) % N_LIN_CONSOLE;
   if (self->arquivo_de_log != NULL) {
-    fprintf(self->arquivo_de_log, "%s\n", s);
+    fputs(s, self->arquivo_de_log);
+    putc('\n', self->arquivo_de_log);
   }
 }
 
@@ -181,20 +272,45 @@ void console_print_status(console_t *self, char *txt)
   sprintf(self->txt_status, "%-*s", N_COL, txt);
 }
 
+static int console_vprintf(console_t *self, char *formato, va_list arg)
+{
+  char s[sizeof(self->txt_console)];
+  int r = vsnprintf(s, sizeof(s), formato, arg);
+  insere_strings_na_console(self, s);
+  return r;
+}
+
 int console_printf(char *formato, ...)
 {
   // esta função usa número variável de argumentos, como o printf.
   // Se não sabe como é isso, dá uma olhada em:
   // https://www.geeksforgeeks.org/variadic-functions-in-c/
   console_t *self = console_global; // gambiarra para simplificar o uso de prints na console
-  char s[sizeof(self->txt_console)];
+  if (self->nivel < MSG_INFO) return 0;
   va_list arg;
   va_start(arg, formato);
-  int r = vsnprintf(s, sizeof(s), formato, arg);
-  insere_strings_na_console(self, s);
+  int r = console_vprintf(self, formato, arg);
+  va_end(arg);
+  return r;
+}
+
+int console_log(nivel_msg_t nivel, char *formato, ...)
+{
+  console_t *self = console_global;
+  // a mensagem nem é formatada se não vai ser mostrada
+  if (nivel > self->nivel) return 0;
+  va_list arg;
+  va_start(arg, formato);
+  int r = console_vprintf(self, formato, arg);
+  va_end(arg);
   return r;
 }
 
+void console_define_nivel(console_t *self, nivel_msg_t nivel)
+{
+  self->nivel = nivel;
+}
+
 // ENTRADA {{{1
 
 static void insere_comando_externo(console_t *self, char c)
@@ -222,7 +338,10 @@ static void interpreta_linha_entrada(console_t *self)
   // Comandos aceitos:
   // Etstr entra a string 'str' no terminal 't'  ex: eb30
   // Zt    esvazia a saída do terminal 't'  ex: za
-  // Dn    altera o tempo de espera do teclado  ex: d0  -> modo turbo
+  // Dn    espera n ms a cada instrução executada  ex: d5  -> mais devagar,
+  //         d0 -> sem espera (o padrão)
+  // Vn    altera o nível das mensagens na console  ex: v0 -> só erros,
+  //         v1 -> sem os detalhes, v2 -> tudo (o padrão)
   // P     para a execução
   // 1     executa uma instrução
   // C     continua a execução
@@ -241,7 +360,15 @@ static void interpreta_linha_entrada(console_t *self)
       break;
     case 'D':
       val = atoi(&linha[1]);
-      tela_espera(val);
+      self->espera_instrucao = val < 0 ? 0 : val;
+      break;
+    case 'V':
+      val = atoi(&linha[1]);
+      if (val < MSG_ERRO || val > MSG_DETALHE) {
+        console_printf("Nível '%s' inválido", &linha[1]);
+      } else {
+        console_define_nivel(self, val);
+      }
       break;
     case 'P':
     case '1':
@@ -258,6 +385,7 @@ static void interpreta_linha_entrada(console_t *self)
 // lê e guarda um caractere do teclado; interpreta linha se for 'enter'
 static void verifica_entrada(console_t *self)
 {
+  if (!self->usa_tela) return;
   char ch = tela_tecla();
 
   int l = strlen(self->txt_entrada);
@@ -274,6 +402,18 @@ static void verifica_entrada(console_t *self)
   } // senão, ignora o caractere digitado
 }
 
+void console_espera_entrada(console_t *self, int ms)
+{
+  if (!self->usa_tela) return;
+  tela_espera_tecla(ms);
+}
+
+void console_espera_instrucao(console_t *self)
+{
+  if (!self->usa_tela || self->espera_instrucao == 0) return;
+  tela_espera_tecla(self->espera_instrucao);
+}
+
 char console_comando_externo(console_t *self)
 {
   verifica_entrada(self);
@@ -282,8 +422,28 @@ char console_comando_externo(console_t *self)
 
 // DESENHO {{{1
 
-static void desenha_linha_terminal(char *txt, int linha, int cor_txt, int cor_cursor)
+// instante atual em ms, de um relógio que não volta para trás
+static long agora_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+// retorna true se 'txt' é diferente do que está desenhado na linha da tela,
+//   e registra que passa a ser o que está desenhado
+static bool linha_mudou(console_t *self, int linha, char *txt)
+{
+  if (strncmp(self->txt_na_tela[linha], txt, N_COL) == 0) return false;
+  strncpy(self->txt_na_tela[linha], txt, N_COL);
+  self->txt_na_tela[linha][N_COL] = '\0';
+  return true;
+}
+
+static void desenha_linha_terminal(console_t *self, char *txt, int linha,
+                                   int cor_txt, int cor_cursor)
 {
+  if (!linha_mudou(self, linha, txt)) return;
   tela_posiciona(linha, 0);
   tela_puts(cor_txt, txt);
   tela_limpa_linha();
@@ -297,13 +457,14 @@ static void desenha_terminais(console_t *self)
     int cor_txt = self->cor_txt[t];
     int cor_cursor = self->cor_cursor[t];
     int linha = LINHA_TERM + t * 2;
-    desenha_linha_terminal(terminal_txt_entrada(terminal), linha, cor_txt, cor_cursor);
-    desenha_linha_terminal(terminal_txt_saida(terminal), linha+1, cor_txt, cor_cursor);
+    desenha_linha_terminal(self, terminal_txt_entrada(terminal), linha, cor_txt, cor_cursor);
+    desenha_linha_terminal(self, terminal_txt_saida(terminal), linha+1, cor_txt, cor_cursor);
   }
 }
 
 static void desenha_status(console_t *self)
 {
+  if (!linha_mudou(self, LINHA_STATUS, self->txt_status)) return;
   tela_posiciona(LINHA_STATUS, 0);
   tela_puts(COR_STATUS, self->txt_status);
   tela_limpa_linha();
@@ -312,8 +473,11 @@ static void desenha_status(console_t *self)
 static void desenha_console(console_t *self)
 {
   for (int l=0; l<N_LIN_CONSOLE; l++) {
+    // a linha mais antiga é a primeira
+    char *txt = self->txt_console[(self->lin_console + l) % N_LIN_CONSOLE];
+    if (!linha_mudou(self, LINHA_CONSOLE + l, txt)) continue;
     tela_posiciona(LINHA_CONSOLE + l, 0);
-    tela_puts(COR_CONSOLE, self->txt_console[l]);
+    tela_puts(COR_CONSOLE, txt);
     tela_limpa_linha();
   }
 }
@@ -321,6 +485,11 @@ static void desenha_console(console_t *self)
 static void desenha_entrada(console_t *self)
 {
   char txt_fixo[] = "P=para C=continua 1=passo F=fim  Ets=entra Zt=zera";
+  if (!linha_mudou(self, LINHA_ENTRADA, self->txt_entrada)) {
+    // o cursor fica no fim da entrada
+    tela_posiciona(LINHA_ENTRADA, strlen(self->txt_entrada));
+    return;
+  }
   tela_posiciona(LINHA_ENTRADA, 0);
   tela_puts(COR_ENTRADA, ""); // gambiarra para limpar na cor certa
   tela_limpa_linha();
@@ -332,6 +501,8 @@ static void desenha_entrada(console_t *self)
 
 static void console_desenha(console_t *self)
 {
+  if (!self->usa_tela) return;
+  self->t_desenho = agora_ms();
   desenha_terminais(self);
   desenha_status(self);
   desenha_console(self);
@@ -342,11 +513,36 @@ static void console_desenha(console_t *self)
 }
 
 // TICTAC {{{1
-void console_tictac(console_t *self)
+bool console_hora_de_desenhar(console_t *self)
+{
+  if (!self->usa_tela) return false;
+  return agora_ms() - self->t_desenho >= INTERVALO_DESENHO;
+}
+
+void console_tictac_terminais(console_t *self)
+{
+  atualiza_terminais(self, 1);
+}
+
+void console_atualiza_tela(console_t *self)
 {
   verifica_entrada(self);
-  atualiza_terminais(self);
   console_desenha(self);
 }
 
+int console_tempo_ate_evento(console_t *self)
+{
+  for (int t = 0; t < N_TERM; t++) {
+    if (self->arquivo_entrada[t] != NULL && !terminal_entrada_cheia(self->term[t])) {
+      return 1;
+    }
+  }
+  return agenda_tempo_ate_proximo(self->agenda);
+}
+
+void console_avanca_terminais(console_t *self, int n)
+{
+  atualiza_terminais(self, n);
+}
+
 // vim: foldmethod=marker
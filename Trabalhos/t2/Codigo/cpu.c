@@ -15,6 +15,30 @@
 #include <assert.h>
 
 // DECLARAÇÃO {{{1
+
+// motor de execução: com CPU_PRE_DECODIFICA em 1, cada instrução é decodificada
+//   uma vez (opcode, argumento e função que a implementa) e guardada em um vetor
+//   indexado pelo endereço físico; as próximas execuções nesse endereço usam a
+//   versão decodificada, até que a memória seja alterada nesse endereço.
+//   Com 0, toda instrução é lida e decodificada a partir da memória.
+//   Para comparar, compile com "make CPPFLAGS=-DCPU_PRE_DECODIFICA=0" e rode
+//   um programa longo (p1 com N bem maior, por exemplo) com -l -v 1.
+#ifndef CPU_PRE_DECODIFICA
+#define CPU_PRE_DECODIFICA 1
+#endif
+
+// uma instrução pré-decodificada
+typedef struct {
+  // a instrução neste endereço já foi decodificada
+  bool valida;
+  // o argumento está na entrada (senão, tem que ser lido da memória)
+  bool tem_A1;
+  int opcode;
+  int A1;
+  // a função que implementa a instrução
+  void (*operacao)(cpu_t *self);
+} instr_decod_t;
+
 // uma CPU tem estado, memória, controlador de ES
 struct cpu_t {
   // registradores
@@ -33,8 +57,17 @@ struct cpu_t {
   // função e argumento para implementar instrução CHAMAC
   func_chamaC_t funcaoC;
   void *argC;
+  // instruções pré-decodificadas, uma por endereço da memória física
+  instr_decod_t *decod;
+  int tam_decod;
+  // instrução em execução, se veio do vetor de pré-decodificadas
+  instr_decod_t *instr;
+  // ciclos que a CPU ainda vai passar ocupada sem executar (ver cpu_ocupa)
+  int ciclos_ocupada;
 };
 
+static void cpu_inicializa_decod(cpu_t *self);
+
 // CRIAÇÃO {{{1
 cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
 {
@@ -52,6 +85,7 @@ cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
   self->complemento = 0;
   self->modo = usuario;
   self->funcaoC = NULL;
+  self->ciclos_ocupada = 0;
   // inicializa instruções privilegiadas
   memset(self->privilegiadas, 0, sizeof(self->privilegiadas));
   self->privilegiadas[PARA] = true;
@@ -59,6 +93,7 @@ cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
   self->privilegiadas[ESCR] = true;
   self->privilegiadas[RETI] = true;
   self->privilegiadas[CHAMAC] = true;
+  cpu_inicializa_decod(self);
   // gera uma interrupção de reset, para o SO poder executar
   cpu_interrompe(self, IRQ_RESET);
 
@@ -68,6 +103,10 @@ cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
 void cpu_destroi(cpu_t *self)
 {
   // eu nao criei MMU nem es; quem criou que destrua!
+  if (self->decod != NULL) {
+    mem_define_observador(mmu_memoria(self->mmu), NULL, NULL);
+    free(self->decod);
+  }
   free(self);
 }
 
@@ -77,6 +116,23 @@ void cpu_define_chamaC(cpu_t *self, func_chamaC_t funcaoC, void *argC)
   self->argC = argC;
 }
 
+bool cpu_parada(cpu_t *self)
+{
+  return self->erro == ERR_CPU_PARADA;
+}
+
+void cpu_ocupa(cpu_t *self, int ciclos)
+{
+  if (ciclos > 0) self->ciclos_ocupada += ciclos;
+}
+
+void cpu_dorme(cpu_t *self, int ciclos)
+{
+  assert(cpu_parada(self));
+  if (ciclos > self->ciclos_ocupada) ciclos = self->ciclos_ocupada;
+  self->ciclos_ocupada -= ciclos;
+}
+
 // IMPRESSÃO {{{1
 static void imprime_registradores(cpu_t *self, char *str)
 {
@@ -158,6 +214,10 @@ static bool pega_opcode(cpu_t *self, int *popc)
 // lê o argumento 1 da instrução no PC
 static bool pega_A1(cpu_t *self, int *pA1)
 {
+  if (self->instr != NULL && self->instr->tem_A1) {
+    *pA1 = self->instr->A1;
+    return true;
+  }
   return pega_mem(self, self->PC + 1, pA1);
 }
 
@@ -422,6 +482,95 @@ static void op_CHAMAS(cpu_t *self) // chamada de sistema
 
 }
 
+// PRÉ-DECODIFICAÇÃO {{{1
+
+static void op_invalida(cpu_t *self) // opcode desconhecido
+{
+  self->erro = ERR_INSTR_INV;
+}
+
+// a função que implementa cada instrução, indexada pelo opcode
+static void (*const operacoes[])(cpu_t *self) = {
+  [NOP]    = op_NOP,    [PARA]   = op_PARA,   [CARGI]  = op_CARGI,
+  [CARGM]  = op_CARGM,  [CARGX]  = op_CARGX,  [ARMM]   = op_ARMM,
+  [ARMX]   = op_ARMX,   [TRAX]   = op_TRAX,   [CPXA]   = op_CPXA,
+  [INCX]   = op_INCX,   [SOMA]   = op_SOMA,   [SUB]    = op_SUB,
+  [MULT]   = op_MULT,   [DIV]    = op_DIV,    [RESTO]  = op_RESTO,
+  [NEG]    = op_NEG,    [DESV]   = op_DESV,   [DESVZ]  = op_DESVZ,
+  [DESVNZ] = op_DESVNZ, [DESVN]  = op_DESVN,  [DESVP]  = op_DESVP,
+  [CHAMA]  = op_CHAMA,  [RET]    = op_RET,    [LE]     = op_LE,
+  [ESCR]   = op_ESCR,   [CHAMAS] = op_CHAMAS, [RETI]   = op_RETI,
+  [CHAMAC] = op_CHAMAC,
+};
+#define N_OPERACOES (int)(sizeof(operacoes) / sizeof(operacoes[0]))
+
+// uma alteração na memória invalida a instrução que começa no endereço
+//   alterado e a que tem o argumento nele
+static void cpu_memoria_alterada(void *arg, int endereco)
+{
+  cpu_t *self = arg;
+  self->decod[endereco].valida = false;
+  if (endereco > 0) self->decod[endereco - 1].valida = false;
+}
+
+static void cpu_inicializa_decod(cpu_t *self)
+{
+  self->instr = NULL;
+  self->decod = NULL;
+  self->tam_decod = 0;
+  if (!CPU_PRE_DECODIFICA) return;
+  mem_t *mem = mmu_memoria(self->mmu);
+  self->tam_decod = mem_tam(mem);
+  self->decod = calloc(self->tam_decod, sizeof(*self->decod));
+  assert(self->decod != NULL);
+  mem_define_observador(mem, cpu_memoria_alterada, self);
+}
+
+// decodifica a instrução no endereço físico endfis
+// o argumento só é guardado se estiver na mesma página que o opcode, porque
+//   senão o endereço físico dele pode mudar sem alteração na memória
+static void cpu_decodifica(cpu_t *self, int endfis, instr_decod_t *instr)
+{
+  mem_t *mem = mmu_memoria(self->mmu);
+  int opcode;
+  mem_le(mem, endfis, &opcode);
+  instr->opcode = opcode;
+  if (opcode >= 0 && opcode < N_OPERACOES && operacoes[opcode] != NULL) {
+    instr->operacao = operacoes[opcode];
+  } else {
+    instr->operacao = op_invalida;
+  }
+  instr->tem_A1 = false;
+  if (instr->operacao != op_invalida && instrucao_num_args(opcode) > 0
+      && DESLOCAMENTO_DO_END(endfis) != TAM_PAGINA - 1
+      && mem_le(mem, endfis + 1, &instr->A1) == ERR_OK) {
+    instr->tem_A1 = true;
+  }
+  instr->valida = true;
+}
+
+// obtém a instrução pré-decodificada no PC, decodificando se necessário
+// retorna true se ela pode ser executada, ou põe em erro o motivo de não poder
+static bool pega_instrucao(cpu_t *self, instr_decod_t **pinstr)
+{
+  int endfis;
+  self->erro = mmu_traduz(self->mmu, self->PC, &endfis, self->modo);
+  if (self->erro != ERR_OK) {
+    self->complemento = self->PC;
+    return false;
+  }
+  instr_decod_t *instr = &self->decod[endfis];
+  if (!instr->valida) cpu_decodifica(self, endfis, instr);
+  // não pode executar instrução privilegiada em modo usuário
+  if (self->modo == usuario && instr->operacao != op_invalida
+      && self->privilegiadas[instr->opcode]) {
+    self->erro = ERR_INSTR_PRIV;
+    return false;
+  }
+  *pinstr = instr;
+  return true;
+}
+
 // EXECUTA UMA INSTRUÇÃO {{{1
 
 static void executa_a_instrucao(cpu_t *self, int opcode)
@@ -461,12 +610,27 @@ static void executa_a_instrucao(cpu_t *self, int opcode)
 
 void cpu_executa_1(cpu_t *self)
 {
+  // o tempo deste ciclo foi gasto em alguma operação do SO (ver cpu_ocupa)
+  if (self->ciclos_ocupada > 0) {
+    self->ciclos_ocupada--;
+    return;
+  }
+
   // não executa se CPU já estiver em erro
   if (self->erro != ERR_OK) return;
 
-  int opcode;
-  if (pega_opcode(self, &opcode)) {
-    executa_a_instrucao(self, opcode);
+  if (CPU_PRE_DECODIFICA) {
+    instr_decod_t *instr;
+    if (pega_instrucao(self, &instr)) {
+      self->instr = instr;
+      instr->operacao(self);
+      self->instr = NULL;
+    }
+  } else {
+    int opcode;
+    if (pega_opcode(self, &opcode)) {
+      executa_a_instrucao(self, opcode);
+    }
   }
 
   // se a CPU entrou em erro, causa uma interrupção
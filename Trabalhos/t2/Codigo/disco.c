@@ -0,0 +1,195 @@
+// disco.c
+// dispositivo de E/S de armazenamento secundário
+// simulador de computador
+// so24b
+
+#include "disco.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+struct disco_t {
+  // memória principal, origem ou destino das transferências
+  mem_t *mem;
+  // conteúdo do disco
+  mem_t *conteudo;
+  int tam_bloco;
+  int n_blocos;
+  // tempos de acesso, em unidades de tempo do relógio
+  int t_busca;
+  int t_transferencia;
+  // próxima transferência (ou a que está sendo realizada)
+  int bloco;
+  int endereco;
+  int comando;
+  // agenda onde é programado o fim da transferência em andamento
+  agenda_t *agenda;
+  evento_t fim_transferencia;
+  // bloco da última transferência, onde está a cabeça
+  int bloco_cabeca;
+  // 1 se está gerando interrupção, 0 se não
+  int interrupcao;
+  // controlador avisado das mudanças em 'interrupcao' (NULL se não tiver)
+  pic_t *pic;
+  irq_t irq;
+  // posição do acesso direto
+  int posicao;
+};
+
+static void disco_fim_transferencia(void *arg);
+
+disco_t *disco_cria(mem_t *mem, agenda_t *agenda, int tam_bloco, int n_blocos,
+                    int t_busca, int t_transferencia)
+{
+  disco_t *self = malloc(sizeof(*self));
+  assert(self != NULL);
+
+  self->mem = mem;
+  self->conteudo = mem_cria(tam_bloco * n_blocos);
+  self->tam_bloco = tam_bloco;
+  self->n_blocos = n_blocos;
+  self->t_busca = t_busca;
+  self->t_transferencia = t_transferencia;
+  self->bloco = 0;
+  self->endereco = 0;
+  self->comando = 0;
+  self->agenda = agenda;
+  evento_inicializa(&self->fim_transferencia, disco_fim_transferencia, self);
+  self->bloco_cabeca = 0;
+  self->interrupcao = 0;
+  self->pic = NULL;
+  self->posicao = 0;
+
+  return self;
+}
+
+void disco_destroi(disco_t *self)
+{
+  agenda_cancela(self->agenda, &self->fim_transferencia);
+  mem_destroi(self->conteudo);
+  free(self);
+}
+
+void disco_define_pic(disco_t *self, pic_t *pic, irq_t irq)
+{
+  self->pic = pic;
+  self->irq = irq;
+}
+
+// altera o pedido de interrupção, avisando o controlador se mudou
+static void disco_muda_interrupcao(disco_t *self, int interrupcao)
+{
+  if (interrupcao == self->interrupcao) return;
+  self->interrupcao = interrupcao;
+  if (self->pic == NULL) return;
+  if (interrupcao) {
+    pic_pede(self->pic, self->irq);
+  } else {
+    pic_retira(self->pic, self->irq);
+  }
+}
+
+// copia o bloco entre o disco e a memória, conforme o comando
+static void disco_transfere(disco_t *self)
+{
+  int end_disco = self->bloco * self->tam_bloco;
+  for (int desloc = 0; desloc < self->tam_bloco; desloc++) {
+    int valor;
+    if (self->comando == DISCO_LE) {
+      mem_le(self->conteudo, end_disco + desloc, &valor);
+      mem_escreve(self->mem, self->endereco + desloc, valor);
+    } else {
+      mem_le(self->mem, self->endereco + desloc, &valor);
+      mem_escreve(self->conteudo, end_disco + desloc, valor);
+    }
+  }
+  self->bloco_cabeca = self->bloco;
+}
+
+// chamada pela agenda no fim da transferência
+static void disco_fim_transferencia(void *arg)
+{
+  disco_t *self = arg;
+  disco_transfere(self);
+  disco_muda_interrupcao(self, 1);
+}
+
+bool disco_ocupado(disco_t *self)
+{
+  return evento_programado(&self->fim_transferencia);
+}
+
+// inicia a transferência pedida pelo comando
+static err_t disco_inicia(disco_t *self, int comando)
+{
+  if (disco_ocupado(self)) return ERR_OCUP;
+  if (comando != DISCO_LE && comando != DISCO_ESCREVE) return ERR_OP_INV;
+  if (self->bloco < 0 || self->bloco >= self->n_blocos) return ERR_END_INV;
+  if (self->endereco < 0
+      || self->endereco + self->tam_bloco > mem_tam(self->mem)) {
+    return ERR_END_INV;
+  }
+  self->comando = comando;
+  int tempo = self->t_transferencia;
+  if (self->bloco != self->bloco_cabeca && self->bloco != self->bloco_cabeca + 1) {
+    tempo += self->t_busca;
+  }
+  // a transferência tem que levar algum tempo, para a interrupção acontecer
+  if (tempo == 0) tempo = 1;
+  agenda_programa(self->agenda, &self->fim_transferencia, tempo);
+  return ERR_OK;
+}
+
+err_t disco_leitura(void *disp, int id, int *pvalor)
+{
+  disco_t *self = disp;
+  err_t err = ERR_OK;
+  switch (id) {
+    case 2:
+      *pvalor = disco_ocupado(self) ? 1 : 0;
+      break;
+    case 3:
+      *pvalor = self->interrupcao;
+      break;
+    case 5:
+      err = mem_le(self->conteudo, self->posicao, pvalor);
+      if (err == ERR_OK) self->posicao++;
+      break;
+    case 6:
+      *pvalor = mem_tam(self->conteudo);
+      break;
+    default:
+      err = ERR_OP_INV;
+  }
+  return err;
+}
+
+err_t disco_escrita(void *disp, int id, int valor)
+{
+  disco_t *self = disp;
+  err_t err = ERR_OK;
+  switch (id) {
+    case 0:
+      self->bloco = valor;
+      break;
+    case 1:
+      self->endereco = valor;
+      break;
+    case 2:
+      err = disco_inicia(self, valor);
+      break;
+    case 3:
+      disco_muda_interrupcao(self, (valor == 0) ? 0 : 1);
+      break;
+    case 4:
+      self->posicao = valor;
+      break;
+    case 5:
+      err = mem_escreve(self->conteudo, self->posicao, valor);
+      if (err == ERR_OK) self->posicao++;
+      break;
+    default:
+      err = ERR_OP_INV;
+  }
+  return err;
+}
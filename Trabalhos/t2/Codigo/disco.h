@@ -0,0 +1,67 @@
+// disco.h
+// dispositivo de E/S de armazenamento secundário
+// simulador de computador
+// so24b
+
+#ifndef DISCO_H
+#define DISCO_H
+
+// simulador de um disco, usado pelo SO como memória secundária
+//
+// o disco é dividido em blocos de tamanho fixo. uma transferência copia um
+//   bloco inteiro entre o disco e a memória principal (por DMA), e leva
+//   algum tempo: 't_busca' unidades de tempo do relógio para posicionar a
+//   cabeça, se o bloco não for o mesmo ou o seguinte ao da última
+//   transferência, mais 't_transferencia' para copiar o bloco.
+//   a cópia é feita no final desse tempo, quando o disco passa a pedir
+//   interrupção. o disco realiza uma transferência por vez.
+//
+// para a carga de programas, o conteúdo do disco pode também ser acessado
+//   palavra a palavra, sem tempo de acesso (simplificação: corresponde a um
+//   programa que já está no disco).
+
+#include "err.h"
+#include "memoria.h"
+#include "pic.h"
+#include "agenda.h"
+
+#include <stdbool.h>
+
+typedef struct disco_t disco_t;
+
+// comandos para iniciar uma transferência (escritos no dispositivo 2)
+#define DISCO_LE      1   // copia o bloco do disco para a memória
+#define DISCO_ESCREVE 2   // copia da memória para o bloco do disco
+
+// cria um disco com 'n_blocos' blocos de 'tam_bloco' palavras, que transfere
+//   dados para a memória principal 'mem'
+// o fim de cada transferência é um evento programado em 'agenda'
+disco_t *disco_cria(mem_t *mem, agenda_t *agenda, int tam_bloco, int n_blocos,
+                    int t_busca, int t_transferencia);
+
+// destrói um disco
+// nenhuma outra operação pode ser realizada no disco após esta chamada
+void disco_destroi(disco_t *self);
+
+// define o controlador de interrupções avisado quando o disco passa a pedir
+//   (e deixa de pedir) a interrupção 'irq'
+void disco_define_pic(disco_t *self, pic_t *pic, irq_t irq);
+
+// retorna true se o disco está realizando uma transferência
+bool disco_ocupado(disco_t *self);
+
+// Funções para acessar o disco como dispositivo de E/S, com id:
+//   '0' para escrever o número do bloco da próxima transferência
+//   '1' para escrever o endereço da memória principal da próxima transferência
+//   '2' para escrever um comando (DISCO_LE ou DISCO_ESCREVE), que inicia a
+//       transferência, ou ler se o disco está ocupado (1) ou não (0)
+//   '3' para ler ou escrever se uma interrupção está sendo pedida
+//   '4' para escrever a posição (endereço no disco) do acesso direto
+//   '5' para ler ou escrever a palavra na posição de acesso direto, que
+//       avança para a seguinte
+//   '6' para ler o tamanho do disco, em palavras
+// Devem seguir o protocolo f_leitura_t e f_escrita_t declarados em es.h
+err_t disco_leitura(void *disp, int id, int *pvalor);
+err_t disco_escrita(void *disp, int id, int valor);
+
+#endif // DISCO_H
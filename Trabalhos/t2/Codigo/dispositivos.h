@@ -27,8 +27,39 @@ typedef enum {
   D_RELOGIO_REAL          = 17,
   D_RELOGIO_TIMER         = 18,
   D_RELOGIO_INTERRUPCAO   = 19,
+  D_TERM_A_TECLADO_INT    = 20,
+  D_TERM_A_TELA_INT       = 21,
+  D_TERM_B_TECLADO_INT    = 22,
+  D_TERM_B_TELA_INT       = 23,
+  D_TERM_C_TECLADO_INT    = 24,
+  D_TERM_C_TELA_INT       = 25,
+  D_TERM_D_TECLADO_INT    = 26,
+  D_TERM_D_TELA_INT       = 27,
+  D_DISCO_BLOCO           = 28,
+  D_DISCO_ENDERECO        = 29,
+  D_DISCO_COMANDO         = 30,
+  D_DISCO_INTERRUPCAO     = 31,
+  D_DISCO_POSICAO         = 32,
+  D_DISCO_DADO            = 33,
+  D_DISCO_TAMANHO         = 34,
+  D_PIC_PENDENTES         = 35,
+  D_PIC_MASCARA           = 36,
   N_DISPOSITIVOS
 } dispositivo_id_t;
 
-#endif // DISPOSITIVOS_H
+#define TECLADO 0
+#define TECLADO_OK 1
+#define TELA 2
+#define TELA_OK 3
+
+#define TERMINAL_A 0
+#define TERMINAL_B 4
+#define TERMINAL_C 8
+#define TERMINAL_D 12
 
+// dispositivos de interrupção do terminal (TERMINAL_A etc); ficam depois dos
+//   outros para não mudar a numeração usada pelos programas
+#define TECLADO_INT(terminal) (D_TERM_A_TECLADO_INT + (terminal) / 2)
+#define TELA_INT(terminal)    (D_TERM_A_TELA_INT + (terminal) / 2)
+
+#endif // DISPOSITIVOS_H
@@ -12,6 +12,9 @@
 struct mem_t {
   int tam;
   int *conteudo;
+  // função chamada a cada alteração (e seu argumento)
+  mem_f_alteracao_t observador;
+  void *arg_observador;
 };
 
 mem_t *mem_cria(int tam)
@@ -24,6 +27,7 @@ mem_t *mem_cria(int tam)
   assert(self->conteudo != NULL);
 
   self->tam = tam;
+  self->observador = NULL;
 
   return self;
 }
@@ -66,6 +70,15 @@ err_t mem_escreve(mem_t *self, int endereco, int valor)
   err_t err = verifica_permissao(self, endereco);
   if (err == ERR_OK) {
     self->conteudo[endereco] = valor;
+    if (self->observador != NULL) {
+      self->observador(self->arg_observador, endereco);
+    }
   }
   return err;
 }
+
+void mem_define_observador(mem_t *self, mem_f_alteracao_t func, void *arg)
+{
+  self->observador = func;
+  self->arg_observador = arg;
+}
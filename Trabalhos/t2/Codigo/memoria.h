@@ -31,4 +31,13 @@ err_t mem_le(mem_t *self, int endereco, int *pvalor);
 // retorna erro ERR_END_INV se endereço inválido
 err_t mem_escreve(mem_t *self, int endereco, int valor);
 
+// tipo da função chamada a cada alteração da memória, com o argumento
+//   fornecido na definição e o endereço alterado
+typedef void (*mem_f_alteracao_t)(void *arg, int endereco);
+
+// define uma função a ser chamada a cada escrita bem sucedida na memória
+//   (usada pela CPU para saber quando uma instrução pré-decodificada muda)
+// NULL para não chamar nada
+void mem_define_observador(mem_t *self, mem_f_alteracao_t func, void *arg);
+
 #endif // MEMORIA_H
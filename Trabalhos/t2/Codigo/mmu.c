@@ -7,14 +7,30 @@
 #include <stdlib.h>
 #include <assert.h>
 
+// uma entrada da TLB: tradução de uma página, e se os bits de acesso e
+//   alteração dessa página já foram marcados na tabela de páginas
+typedef struct {
+  bool valida;
+  int pagina;
+  int quadro;
+  bool acessada;
+  bool alterada;
+} tlb_entrada_t;
+
 // tipo de dados opaco para representar uma MMU
 struct mmu_t {
   // memória física
   mem_t *mem;
   // tabela de páginas
   tabpag_t *tabpag;
+  // cache das traduções mais recentes
+  tlb_entrada_t tlb[TAM_TLB];
+  long tlb_acertos;
+  long tlb_falhas;
 };
 
+static void mmu__esvazia_tlb(mmu_t *self);
+
 mmu_t *mmu_cria(mem_t *mem)
 {
   mmu_t *self;
@@ -22,6 +38,9 @@ mmu_t *mmu_cria(mem_t *mem)
   assert(self != NULL);
   self->mem = mem;
   self->tabpag = NULL;
+  self->tlb_acertos = 0;
+  self->tlb_falhas = 0;
+  mmu__esvazia_tlb(self);
   return self;
 }
 
@@ -29,28 +48,111 @@ void mmu_destroi(mmu_t *self)
 {
   if (self != NULL) {
     // nem a tabela de páginas nem a memória pertencem à MMU, não são liberadas aqui
+    if (self->tabpag != NULL) tabpag_define_observador(self->tabpag, NULL, NULL);
     free(self);
   }
 }
 
+// TLB
+
+static void mmu__esvazia_tlb(mmu_t *self)
+{
+  for (int i = 0; i < TAM_TLB; i++) {
+    self->tlb[i].valida = false;
+    self->tlb[i].pagina = -1;
+  }
+}
+
+// chamada pela tabela de páginas quando a informação de uma página muda
+static void mmu__pagina_alterada(void *arg, int pagina)
+{
+  mmu_t *self = arg;
+  if (pagina < 0) return;
+  tlb_entrada_t *entrada = &self->tlb[pagina % TAM_TLB];
+  if (entrada->pagina == pagina) {
+    entrada->valida = false;
+  }
+}
+
 void mmu_define_tabpag(mmu_t *self, tabpag_t *tabpag)
 {
+  // a TLB continua válida se a tabela não muda
+  if (tabpag == self->tabpag) return;
+  if (self->tabpag != NULL) tabpag_define_observador(self->tabpag, NULL, NULL);
   self->tabpag = tabpag;
+  if (tabpag != NULL) tabpag_define_observador(tabpag, mmu__pagina_alterada, self);
+  mmu__esvazia_tlb(self);
+}
+
+void mmu_tlb_estatisticas(mmu_t *self, long *pacertos, long *pfalhas)
+{
+  *pacertos = self->tlb_acertos;
+  *pfalhas = self->tlb_falhas;
 }
 
-// tradur o endereço virtual 'endvirt', colocando o endereço físico
-//   correspondente em 'pendfis'.
+// TRADUÇÃO
+
+// traduz o endereço virtual 'endvirt', colocando o endereço físico
+//   correspondente em 'pendfis' e a entrada da TLB que contém a tradução
+//   em 'pentrada'.
 // retorna ERR_OK ou um erro se a tradução não for possível
-static err_t mmu__traduz(mmu_t *self, int endvirt, int *pendfis)
+static err_t mmu__traduz(mmu_t *self, int endvirt, int *pendfis,
+                         tlb_entrada_t **pentrada)
 {
-  int pagina = endvirt / TAM_PAGINA;
-  int deslocamento = endvirt % TAM_PAGINA;
-  int quadro;
-  err_t err = tabpag_traduz(self->tabpag, pagina, &quadro);
-  if (err == ERR_OK) {
-    *pendfis = quadro * TAM_PAGINA + deslocamento;
+  int pagina = PAGINA_DO_END(endvirt);
+  int deslocamento = DESLOCAMENTO_DO_END(endvirt);
+  // página negativa nunca é válida, nem vai para a TLB
+  if (pagina < 0) return ERR_PAG_AUSENTE;
+  tlb_entrada_t *entrada = &self->tlb[pagina % TAM_TLB];
+  if (entrada->valida && entrada->pagina == pagina) {
+    self->tlb_acertos++;
+  } else {
+    self->tlb_falhas++;
+    int quadro;
+    err_t err = tabpag_traduz(self->tabpag, pagina, &quadro);
+    if (err != ERR_OK) return err;
+    entrada->valida = true;
+    entrada->pagina = pagina;
+    entrada->quadro = quadro;
+    entrada->acessada = false;
+    entrada->alterada = false;
   }
-  return err;
+  *pendfis = entrada->quadro * TAM_PAGINA + deslocamento;
+  *pentrada = entrada;
+  return ERR_OK;
+}
+
+// marca na tabela de páginas o acesso à página da entrada, se a TLB ainda
+//   não sabe que ele foi marcado
+static void mmu__marca_acesso(mmu_t *self, tlb_entrada_t *entrada,
+                              bool alteracao)
+{
+  if (entrada->acessada && (entrada->alterada || !alteracao)) return;
+  tabpag_marca_bit_acesso(self->tabpag, entrada->pagina, alteracao);
+  entrada->acessada = true;
+  if (alteracao) entrada->alterada = true;
+}
+
+mem_t *mmu_memoria(mmu_t *self)
+{
+  return self->mem;
+}
+
+err_t mmu_traduz(mmu_t *self, int endvirt, int *pendfis, cpu_modo_t modo)
+{
+  int endfis = endvirt;
+  tlb_entrada_t *entrada = NULL;
+  bool traduz = modo != supervisor && self->tabpag != NULL;
+  if (traduz) {
+    err_t err = mmu__traduz(self, endvirt, &endfis, &entrada);
+    if (err != ERR_OK) return err;
+  }
+  if (endfis < 0 || endfis >= mem_tam(self->mem)) return ERR_END_INV;
+  if (traduz) {
+    mmu__marca_acesso(self, entrada, false);
+  }
+  *pendfis = endfis;
+  return ERR_OK;
 }
 
 err_t mmu_le(mmu_t *self, int endvirt, int *pvalor, cpu_modo_t modo)
@@ -61,11 +163,12 @@ err_t mmu_le(mmu_t *self, int endvirt, int *pvalor, cpu_modo_t modo)
     return mem_le(self->mem, endvirt, pvalor);
   }
   int endfis;
-  err_t err = mmu__traduz(self, endvirt, &endfis);
+  tlb_entrada_t *entrada;
+  err_t err = mmu__traduz(self, endvirt, &endfis, &entrada);
   if (err == ERR_OK) {
     err = mem_le(self->mem, endfis, pvalor);
     if (err == ERR_OK) {
-      tabpag_marca_bit_acesso(self->tabpag, endvirt / TAM_PAGINA, false);
+      mmu__marca_acesso(self, entrada, false);
     }
   }
   return err;
@@ -79,11 +182,12 @@ err_t mmu_escreve(mmu_t *self, int endvirt, int valor, cpu_modo_t modo)
     return mem_escreve(self->mem, endvirt, valor);
   }
   int endfis;
-  err_t err = mmu__traduz(self, endvirt, &endfis);
+  tlb_entrada_t *entrada;
+  err_t err = mmu__traduz(self, endvirt, &endfis, &entrada);
   if (err == ERR_OK) {
     err = mem_escreve(self->mem, endfis, valor);
     if (err == ERR_OK) {
-      tabpag_marca_bit_acesso(self->tabpag, endvirt / TAM_PAGINA, true);
+      mmu__marca_acesso(self, entrada, true);
     }
   }
   return err;
@@ -21,7 +21,32 @@ typedef struct mmu_t mmu_t;
 
 // tamanho de uma página, em palavras de memória
 // t2: pode ser alterado para comparar configurações diferentes
+//   para páginas com tamanho potência de 2, defina BITS_PAGINA em vez de
+//   TAM_PAGINA (por exemplo, "make CPPFLAGS=-DBITS_PAGINA=4" para páginas de
+//   16 palavras); com isso a tradução de endereços usa deslocamento de bits e
+//   máscara em vez de divisão e resto
+#ifdef BITS_PAGINA
+#define TAM_PAGINA (1 << BITS_PAGINA)
+#elif !defined(TAM_PAGINA)
 #define TAM_PAGINA 10
+#endif
+
+// número da página e deslocamento dentro da página de um endereço
+// com BITS_PAGINA, são calculados com deslocamento e máscara, a não ser que
+//   PAGINA_POR_DIVISAO também esteja definido (para medir a diferença com o
+//   mesmo tamanho de página, ver bench_mmu.c)
+#if defined(BITS_PAGINA) && !defined(PAGINA_POR_DIVISAO)
+#define PAGINA_DO_END(end)       ((end) >> BITS_PAGINA)
+#define DESLOCAMENTO_DO_END(end) ((end) & (TAM_PAGINA - 1))
+#else
+#define PAGINA_DO_END(end)       ((end) / TAM_PAGINA)
+#define DESLOCAMENTO_DO_END(end) ((end) % TAM_PAGINA)
+#endif
+
+// número de entradas na TLB (mapeamento direto: a página p só pode estar na
+//   entrada p % TAM_TLB)
+// t2: pode ser alterado para comparar configurações diferentes
+#define TAM_TLB 16
 
 // cria uma MMU para gerenciar acessos à memória
 // retorna um ponteiro para um descritor, que deverá ser usado em todas
@@ -36,8 +61,25 @@ void mmu_destroi(mmu_t *self);
 
 // define a tabela de páginas a usar nas próximas traduções
 // se tabpag for NULL, os acessos serão repassados sem alteração à memória
+// esvazia a TLB
 void mmu_define_tabpag(mmu_t *self, tabpag_t *tabpag);
 
+// coloca em '*pacertos' o número de traduções resolvidas pela TLB e em
+//   '*pfalhas' o número das que precisaram consultar a tabela de páginas
+//   (acessos sem tradução não são contados)
+void mmu_tlb_estatisticas(mmu_t *self, long *pacertos, long *pfalhas);
+
+// retorna a memória física gerenciada pela MMU
+mem_t *mmu_memoria(mmu_t *self);
+
+// coloca na posição apontada por 'pendfis' o endereço físico correspondente
+//   ao endereço virtual 'endvirt', sem acessar a memória
+// marca a página como acessada se a tradução for bem sucedida (como mmu_le)
+// retorna os mesmos erros que mmu_le (de tradução ou de endereço físico
+//   inválido)
+// em modo supervisor ou sem tabela de páginas, 'endvirt' é o endereço físico
+err_t mmu_traduz(mmu_t *self, int endvirt, int *pendfis, cpu_modo_t modo);
+
 // coloca na posição apontada por 'pvalor' o valor que está na memória
 //   no endereço físico correspondente ao endereço virtual 'endvirt'
 // marca a página como acessada se o acesso for bem sucedido
@@ -0,0 +1,135 @@
+// pic.c
+// controlador de interrupções
+// simulador de computador
+// so24b
+
+#include "pic.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+struct pic_t {
+  // bit n em 1 se a IRQ n está pendente
+  unsigned pendentes;
+  // bit n em 1 se a IRQ n está mascarada
+  unsigned mascara;
+  // quantos dispositivos estão pedindo cada IRQ
+  int n_pedidos[N_IRQ];
+  int prioridade[N_IRQ];
+  // as IRQs em ordem de preferência (recalculada quando muda uma prioridade)
+  irq_t ordem[N_IRQ];
+};
+
+static void pic_ordena(pic_t *self);
+
+pic_t *pic_cria(void)
+{
+  pic_t *self = malloc(sizeof(*self));
+  assert(self != NULL);
+  // o mapa de bits precisa de um bit por IRQ
+  assert(N_IRQ <= sizeof(self->pendentes) * 8);
+
+  self->pendentes = 0;
+  self->mascara = 0;
+  for (int irq = 0; irq < N_IRQ; irq++) {
+    self->n_pedidos[irq] = 0;
+    self->prioridade[irq] = 0;
+  }
+  pic_ordena(self);
+
+  return self;
+}
+
+void pic_destroi(pic_t *self)
+{
+  free(self);
+}
+
+// coloca as IRQs em ordem decrescente de prioridade, e crescente de número
+//   entre as de mesma prioridade (inserção, são poucas)
+static void pic_ordena(pic_t *self)
+{
+  for (int i = 0; i < N_IRQ; i++) {
+    irq_t irq = i;
+    int j = i;
+    while (j > 0 && self->prioridade[self->ordem[j - 1]] < self->prioridade[irq]) {
+      self->ordem[j] = self->ordem[j - 1];
+      j--;
+    }
+    self->ordem[j] = irq;
+  }
+}
+
+void pic_pede(pic_t *self, irq_t irq)
+{
+  assert(irq >= 0 && irq < N_IRQ);
+  self->n_pedidos[irq]++;
+  self->pendentes |= 1u << irq;
+}
+
+void pic_retira(pic_t *self, irq_t irq)
+{
+  assert(irq >= 0 && irq < N_IRQ && self->n_pedidos[irq] > 0);
+  self->n_pedidos[irq]--;
+  if (self->n_pedidos[irq] == 0) self->pendentes &= ~(1u << irq);
+}
+
+void pic_define_prioridade(pic_t *self, irq_t irq, int prioridade)
+{
+  assert(irq >= 0 && irq < N_IRQ);
+  self->prioridade[irq] = prioridade;
+  pic_ordena(self);
+}
+
+void pic_define_mascara(pic_t *self, irq_t irq, bool mascarada)
+{
+  assert(irq >= 0 && irq < N_IRQ);
+  if (mascarada) {
+    self->mascara |= 1u << irq;
+  } else {
+    self->mascara &= ~(1u << irq);
+  }
+}
+
+bool pic_proxima(pic_t *self, irq_t *pirq)
+{
+  unsigned prontas = self->pendentes & ~self->mascara;
+  // o caso comum, sem interrupção, é resolvido sem percorrer as IRQs
+  if (prontas == 0) return false;
+  for (int i = 0; i < N_IRQ; i++) {
+    if (prontas & (1u << self->ordem[i])) {
+      *pirq = self->ordem[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+err_t pic_leitura(void *disp, int id, int *pvalor)
+{
+  pic_t *self = disp;
+  switch (id) {
+    case 0:
+      *pvalor = self->pendentes;
+      break;
+    case 1:
+      *pvalor = self->mascara;
+      break;
+    default:
+      return ERR_END_INV;
+  }
+  return ERR_OK;
+}
+
+err_t pic_escrita(void *disp, int id, int valor)
+{
+  pic_t *self = disp;
+  switch (id) {
+    case 1:
+      self->mascara = valor & ((1u << N_IRQ) - 1);
+      break;
+    default:
+      return ERR_END_INV;
+  }
+  return ERR_OK;
+}
@@ -0,0 +1,61 @@
+// pic.h
+// controlador de interrupções
+// simulador de computador
+// so24b
+
+#ifndef PIC_H
+#define PIC_H
+
+// simulador de um controlador programável de interrupções (PIC)
+//
+// os dispositivos de E/S avisam o controlador quando passam a pedir uma
+//   interrupção (pic_pede) e quando deixam de pedir (pic_retira). uma IRQ
+//   pode ser compartilhada por mais de um dispositivo, e fica pendente
+//   enquanto algum deles estiver pedindo.
+// cada IRQ pode ser mascarada, e tem uma prioridade. após cada instrução, o
+//   controle da CPU pergunta ao controlador qual a IRQ pendente e não
+//   mascarada de maior prioridade (pic_proxima), e a repassa para a CPU. a
+//   IRQ continua pendente até o dispositivo deixar de pedir (normalmente
+//   quando o SO atende o dispositivo), então uma interrupção não aceita pela
+//   CPU é repassada de novo depois.
+// as interrupções geradas pela própria CPU não passam pelo controlador.
+
+#include "err.h"
+#include "irq.h"
+
+#include <stdbool.h>
+
+typedef struct pic_t pic_t;
+
+// cria um controlador de interrupções, com todas as IRQs desmascaradas e
+//   com a mesma prioridade
+pic_t *pic_cria(void);
+
+// destrói um controlador de interrupções
+void pic_destroi(pic_t *self);
+
+// um dispositivo passa a pedir a interrupção 'irq'
+void pic_pede(pic_t *self, irq_t irq);
+
+// um dispositivo deixa de pedir a interrupção 'irq'
+void pic_retira(pic_t *self, irq_t irq);
+
+// define a prioridade da IRQ (maior valor, maior prioridade)
+// entre IRQs de mesma prioridade, a de menor número tem preferência
+void pic_define_prioridade(pic_t *self, irq_t irq, int prioridade);
+
+// mascara (se 'mascarada' for true) ou desmascara a IRQ
+void pic_define_mascara(pic_t *self, irq_t irq, bool mascarada);
+
+// coloca em *pirq a IRQ pendente e não mascarada de maior prioridade
+// retorna false se não tiver nenhuma
+bool pic_proxima(pic_t *self, irq_t *pirq);
+
+// Funções para acessar o controlador como dispositivo de E/S, com id:
+//   '0' para ler as IRQs pendentes (o bit n em 1 se a IRQ n estiver pendente)
+//   '1' para ler ou escrever a máscara (o bit n em 1 mascara a IRQ n)
+// Devem seguir o protocolo f_leitura_t e f_escrita_t declarados em es.h
+err_t pic_leitura(void *disp, int id, int *pvalor);
+err_t pic_escrita(void *disp, int id, int valor);
+
+#endif // PIC_H
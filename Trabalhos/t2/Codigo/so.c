@@ -6,38 +6,235 @@
 // INCLUDES {{{1
 #include "so.h"
 #include "dispositivos.h"
+#include "disco.h"
 #include "irq.h"
+#include "fila_prio.h"
+#include "mapa.h"
 #include "programa.h"
 #include "tabpag.h"
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
 // CONSTANTES E TIPOS {{{1
+// os valores de INTERVALO_INTERRUPCAO, ESCALONADOR, QUANTUM, SUBSTITUICAO e
+//   DISCO_T_* são só os padrões, a configuração usada é a passada para
+//   so_cria (so_config_t)
 // intervalo entre interrupções do relógio
 #define INTERVALO_INTERRUPCAO 50   // em instruções executadas
+#define TAM_TABELA_PROCESSOS 8
 
-// Não tem processos nem memória virtual, mas é preciso usar a paginação,
-//   pelo menos para implementar relocação, já que os programas estão sendo
-//   todos montados para serem executados no endereço 0 e o endereço 0
-//   físico é usado pelo hardware nas interrupções.
-// Os programas estão sendo carregados no início de um quadro, e usam quantos
-//   quadros forem necessárias. Para isso a variável quadro_livre contém
-//   o número do primeiro quadro da memória principal que ainda não foi usado.
-//   Na carga do processo, a tabela de páginas (deveria ter uma por processo,
-//   mas não tem processo) é alterada para que o endereço virtual 0 resulte
-//   no quadro onde o programa foi carregado. Com isso, o programa carregado
-//   é acessível, mas o acesso ao anterior é perdido.
-
-// t2: a interface de algumas funções que manipulam memória teve que ser alterada,
-//   para incluir o processo ao qual elas se referem. Para isso, precisa de um
-//   tipo para o processo. Neste código, não tem processos implementados, e não
-//   tem um tipo para isso. Chutei o tipo int. Foi necessário também um valor para
-//   representar a inexistência de um processo, coloquei -1. Altere para o seu
-//   tipo, ou substitua os usos de processo_t e NENHUM_PROCESSO para o seu tipo.
-typedef int processo_t;
-#define NENHUM_PROCESSO -1
+// define qual o escalonador a ser usado: 0 para simples, 1 para round-robin, 2 para prioridade
+//   e 3 para múltiplas filas com realimentação
+#define ESCALONADOR 1
+#define QUANTUM 5
+
+// escalonador de múltiplas filas: número de níveis, quantum de cada nível (em
+//   interrupções do relógio, do nível mais prioritário, 0, para o menos) e
+//   intervalo entre as voltas de todos os processos para o nível 0
+#define MLFQ_NIVEIS 3
+static int mlfq_quantum[MLFQ_NIVEIS] = { 2, 5, 10 };
+#define MLFQ_PERIODO_BOOST 2000   // em instruções executadas
+
+typedef struct processo_t processo_t;
+typedef struct metricas_so_t metricas_so_t;
+typedef struct metricas_processo_t metricas_processo_t;
+
+// fila de processos bloqueados esperando alguma coisa (um processo morrer, um
+//   terminal), na ordem em que bloquearam; encadeada pelos descritores
+typedef struct {
+  processo_t *ini;
+  processo_t *fim;
+} fila_espera_t;
+
+#define N_TERMINAIS 4
+
+static void so_escalona_simples(so_t *self);
+static void so_escalona_round_robin(so_t *self);
+static void so_escalona_prioridade(so_t *self);
+static void so_escalona_mlfq(so_t *self);
+
+typedef void (*escalonador_func_t)(so_t *self);
+escalonador_func_t escalonadores[] = {so_escalona_simples, so_escalona_round_robin, so_escalona_prioridade, so_escalona_mlfq};
+#define N_ESCALONADORES (sizeof(escalonadores) / sizeof(escalonadores[0]))
+
+// define o algoritmo de substituição de páginas: 0 para FIFO, 1 para segunda
+//   chance, 2 para LRU aproximado por envelhecimento e 3 para WSClock
+#define SUBSTITUICAO 1
+// latências do disco (os valores padrão de so_config_t)
+#define DISCO_T_BUSCA 100          // em instruções executadas
+#define DISCO_T_TRANSFERENCIA 20   // em instruções executadas, por bloco
+// no WSClock, página não usada há mais que isso está fora do conjunto de trabalho
+#define TAU_WSCLOCK 500   // em instruções executadas
+// no envelhecimento, número de interrupções de relógio lembradas por página
+#define BITS_IDADE 8
+
+static int so_substitui_fifo(so_t *self);
+static int so_substitui_segunda_chance(so_t *self);
+static int so_substitui_lru(so_t *self);
+static int so_substitui_wsclock(so_t *self);
+static void so_envelhece_quadros(so_t *self);
+
+// um algoritmo de substituição de páginas
+typedef struct {
+  char *nome;
+  // escolhe o quadro cuja página vai ser retirada da memória principal
+  int (*escolhe_quadro)(so_t *self);
+  // chamada a cada interrupção do relógio, NULL se o algoritmo não precisa
+  void (*tictac)(so_t *self);
+} substituicao_t;
+substituicao_t substituicoes[] = {
+  { "FIFO",           so_substitui_fifo,           NULL                 },
+  { "segunda chance", so_substitui_segunda_chance, NULL                 },
+  { "LRU aproximado", so_substitui_lru,            so_envelhece_quadros },
+  { "WSClock",        so_substitui_wsclock,        NULL                 },
+};
+#define N_SUBSTITUICOES (sizeof(substituicoes) / sizeof(substituicoes[0]))
+
+typedef enum {
+  MORTO,
+  BLOQUEADO,
+  PRONTO,
+  N_ESTADOS
+} process_estado_t;
+
+typedef enum {
+  ESCRITA,
+  LEITURA,
+  ESPERANDO_MORRER,
+  PAGINACAO,
+  OK
+} process_r_bloq_t;
+
+
+// structs metricas
+struct metricas_so_t {
+  int t_total;
+  int t_ocioso;
+  int n_interrupcoes[N_IRQ];
+  int preempcoes;
+  // trocas do processo em execução e tempo gasto com elas (ver so_troca_contexto)
+  int n_trocas;
+  int t_troca_contexto;
+  // traduções de endereço resolvidas ou não pela TLB da MMU (copiadas da
+  //   MMU quando as métricas são gravadas)
+  long tlb_acertos;
+  long tlb_falhas;
+};
+
+struct metricas_processo_t {
+  int t_retorno;
+  int preempcoes;
+  int n_estados[N_ESTADOS];
+  int t_estados[N_ESTADOS];
+  int t_resposta;
+  // instante em que o tempo no estado atual começou a ser contado; o tempo
+  //   só é acumulado em t_estados quando o estado muda (ou as métricas são
+  //   gravadas), não a cada interrupção
+  int t_mudanca;
+  int faltas_de_pagina;
+  // páginas do processo retiradas da memória principal
+  int paginas_retiradas;
+  // páginas do processo copiadas de volta para a memória secundária
+  int paginas_salvas;
+};
+
+struct processo_t {
+  int process_id;
+  // posição na tabela de processos
+  int slot;
+  int reg_a;
+  int reg_x;
+  int reg_pc;
+  int reg_erro;
+  int reg_complemento;
+
+  process_estado_t estado;
+  process_r_bloq_t razao;
+
+  int terminal;
+
+  float prioridade;
+  // nível no escalonador de múltiplas filas (0 é o mais prioritário)
+  int nivel;
+
+  // encadeamento na fila de prontos (na_fila é false se não estiver nela)
+  processo_t *fila_ant;
+  processo_t *fila_prox;
+  bool na_fila;
+
+  // processos bloqueados esperando este morrer (SO_ESPERA_PROC)
+  fila_espera_t esperas;
+  // fila de espera em que o processo está (NULL se não está em nenhuma), e
+  //   o encadeamento nela
+  fila_espera_t *em_espera;
+  processo_t *espera_ant;
+  processo_t *espera_prox;
+  // caractere a escrever, enquanto o pedido de escrita espera a tela
+  int dado_escrita;
+
+  // tabela de páginas do processo, colocada na MMU quando ele é despachado
+  tabpag_t *tabpag;
+  // o processo tem n_paginas páginas, a partir da página 0, guardadas em
+  //   sequência no disco a partir do bloco bloco_disco
+  int bloco_disco;
+  int n_paginas;
+  // página que causou a última falta de página do processo, desde a falta
+  //   até ele executar a instrução que a causou (-1 fora disso); enquanto
+  //   isso, ela e as páginas da instrução (a do opcode, no PC, e a do
+  //   argumento, logo depois) não são escolhidas pela substituição, para que
+  //   a instrução encontre tudo na memória quando executar de novo
+  int pagina_em_falta;
+  // PC da instrução que causou a falta; a instrução foi executada quando o
+  //   processo é interrompido com outro PC (não basta ele ser despachado,
+  //   pode ser interrompido antes de executar)
+  int pc_em_falta;
+  // ordem da primeira falta da instrução, entre as de todos os processos
+  long n_falta;
+  // a falta foi adiada por falta de quadro; as páginas da instrução de um
+  //   processo adiado podem ser escolhidas para a falta de um processo com
+  //   falta mais antiga, para que o mais antigo sempre consiga andar
+  bool falta_adiada;
+  // pedidos ao disco com páginas do processo que ainda não terminaram; o
+  //   descritor de um processo morto só pode ser reaproveitado quando não
+  //   tiver mais nenhum
+  int n_pedidos_disco;
+
+  metricas_processo_t metricas;
+};
+
+// descrição de um quadro da memória principal
+// quadro livre tem processo NULL; senão contém a página 'pagina' do processo,
+//   que foi a carga número 'n_carga' feita pelo SO
+typedef struct {
+  processo_t *processo;
+  int pagina;
+  int n_carga;
+  // envelhecimento: bits de acesso das últimas interrupções de relógio, o
+  //   mais recente no bit mais alto
+  unsigned idade;
+  // WSClock: instante do último uso conhecido da página
+  int t_uso;
+  // true se a página está indo ou vindo do disco
+  bool em_transferencia;
+} quadro_t;
+
+// transferência de página pedida ao disco
+typedef enum {
+  CARGA,        // do disco para o quadro, para atender uma falta de página
+  DESCARGA,     // do quadro para o disco, de uma página retirada do quadro
+  SALVAMENTO    // do quadro para o disco, a página continua no quadro
+} pedido_tipo_t;
+
+typedef struct {
+  pedido_tipo_t tipo;
+  processo_t *processo;
+  int pagina;
+  int quadro;
+} pedido_disco_t;
 
 struct so_t {
   cpu_t *cpu;
@@ -46,36 +243,700 @@ struct so_t {
   es_t *es;
   console_t *console;
   bool erro_interno;
-  // t1: tabela de processos, processo corrente, pendências, etc
-
-  // primeiro quadro da memória que está livre (quadros anteriores estão ocupados)
-  // t2: com memória virtual, o controle de memória livre e ocupada é mais
-  //     completo que isso
-  int quadro_livre;
-  // uma tabela de páginas para poder usar a MMU
-  // t2: com processos, não tem esta tabela global, tem que ter uma para
-  //     cada processo
-  tabpag_t *tabpag_global;
+
+  processo_t *processo_corrente;
+  // tabela de processos, com 'n_slots' posições usadas de 'max_processos'
+  // um processo morto continua na tabela até a sua posição ser usada por um
+  //   processo novo; as posições que podem ser reaproveitadas ficam na pilha
+  //   'slots_livres'
+  processo_t **tabela_processos;
+  int n_slots;
+  int max_processos;
+  int *slots_livres;
+  int n_livres;
+  // posição na tabela de cada processo, pelo pid
+  mapa_t *slot_do_pid;
+  // métricas dos processos mortos que saíram da tabela (o descritor deles é
+  //   liberado), somadas, e quantos são
+  metricas_processo_t metricas_mortos;
+  int n_mortos;
+  // pid do próximo processo criado (os pids não são reaproveitados)
+  int id_processo;
+  // processos criados, e que ainda não morreram
+  int qnt_processos;
+  int n_vivos;
+
+  so_config_t config;
+
+  int quantum;
+  // fila de prontos, duplamente encadeada pelos descritores dos processos,
+  //   para inserir no fim e remover qualquer processo em tempo constante
+  processo_t *fila_ini;
+  processo_t *fila_fim;
+  int n_prontos;
+  // pedidos de leitura e de escrita esperando cada terminal (o índice é o
+  //   terminal / 4), atendidos na ordem de chegada quando ele fica pronto
+  fila_espera_t esperas_teclado[N_TERMINAIS];
+  fila_espera_t esperas_tela[N_TERMINAIS];
+  // os mesmos processos prontos, ordenados por prioridade (pid como
+  //   identificador), para os escalonadores por prioridade e de múltiplas
+  //   filas (ver chave_pronto)
+  fila_prio_t *prontos_prio;
+  // quando os processos voltaram para o nível 0 no escalonador de múltiplas filas
+  int ultimo_boost;
+
+  // quadros da memória principal (os anteriores a quadro_ini são do SO)
+  quadro_t *quadros;
+  int n_quadros;
+  int quadro_ini;
+  // número de páginas já carregadas na memória principal
+  int n_cargas;
+  // número de instruções que já causaram falta de página
+  long n_faltas;
+  // processo cuja falta de página está escolhendo um quadro para substituir
+  processo_t *proc_em_falta;
+  // próximo quadro a ser examinado pelos algoritmos de relógio
+  int ponteiro;
+  // primeiro bloco livre do disco, e número de blocos
+  // o disco é ocupado em sequência na carga dos programas, e nunca é liberado
+  int bloco_livre;
+  int n_blocos;
+  // fila circular de pedidos ao disco; o primeiro está sendo realizado
+  pedido_disco_t *pedidos;
+  int tam_pedidos;
+  int ini_pedidos;
+  int n_pedidos;
+
+  int relogio;
+  metricas_so_t metricas;
+  // arquivo de métricas, aberto na primeira amostra (NULL se não estiver aberto)
+  FILE *arq_metricas;
+  // instante da próxima amostra das métricas
+  int proxima_amostra;
 };
 
 
+// função de calculo de terminal
+static int terminal_processo(int terminal, int tipo){
+  return terminal + tipo;
+}
+
+
 // função de tratamento de interrupção (entrada no SO)
 static int so_trata_interrupcao(void *argC, int reg_A);
 
 // funções auxiliares
-// no t2, foi adicionado o 'processo' aos argumentos dessas funções 
-// carrega o programa na memória virtual de um processo; retorna end. inicial
-static int so_carrega_programa(so_t *self, processo_t processo,
+// carrega o programa na memória virtual de um processo (ou na física se o
+//   processo for NULL); retorna end. inicial
+static int so_carrega_programa(so_t *self, processo_t *processo,
                                char *nome_do_executavel);
 // copia para str da memória do processo, até copiar um 0 (retorna true) ou tam bytes
 static bool so_copia_str_do_processo(so_t *self, int tam, char str[tam],
-                                     int end_virt, processo_t processo);
+                                     int end_virt, processo_t *processo);
+// libera os quadros e a tabela de páginas de um processo que morreu
+static void so_libera_memoria_processo(so_t *self, processo_t *proc);
+
+
+// TABELA DE PROCESSOS {{{1
+// funções auxiliares para a tabela de processos
+static processo_t *cria_processo(int process_id, int reg_pc);
+static void mata_processo(so_t *self, int process_id);
+static processo_t *busca_processo(so_t *self, int process_id);
+static void libera_slot(so_t *self, processo_t *proc);
+static void sai_da_espera(processo_t *proc);
+static void entra_na_espera(processo_t *proc, fila_espera_t *fila);
+static fila_espera_t *fila_do_terminal(so_t *self, int terminal, process_r_bloq_t razao);
+static void acorda_esperas(so_t *self, processo_t *proc);
+static processo_t *so_adiciona_processo(so_t *self, char *nome_do_executavel);
+static void ajusta_fila(so_t *self, processo_t *proc);
+
+
+// FUNÇÕES DE METRICAS {{{1
+static void inicializa_metricas_processo(metricas_processo_t *metricas){
+  metricas->t_retorno = 0;
+  metricas->preempcoes = 0;
+  for (int i = 0; i < N_ESTADOS; i++){
+    metricas->n_estados[i] = 0;
+    metricas->t_estados[i] = 0;
+  }
+  metricas->t_resposta = 0;
+  metricas->t_mudanca = 0;
+  metricas->faltas_de_pagina = 0;
+  metricas->paginas_retiradas = 0;
+  metricas->paginas_salvas = 0;
+
+  metricas->n_estados[PRONTO] = 1;
+}
+
+// acumula o tempo que o processo passou no estado atual até 'agora'
+static void acumula_tempo_estado(processo_t *proc, int agora){
+  int d_tempo = agora - proc->metricas.t_mudanca;
+  if (proc->estado != MORTO){
+    proc->metricas.t_retorno += d_tempo;
+  }
+  proc->metricas.t_estados[proc->estado] += d_tempo;
+  proc->metricas.t_mudanca = agora;
+}
+
+// acumula o tempo que os mortos que saíram da tabela passaram mortos até agora
+static void acumula_tempo_mortos(so_t *self){
+  metricas_processo_t *soma = &self->metricas_mortos;
+  soma->t_estados[MORTO] += self->n_mortos * (self->relogio - soma->t_mudanca);
+  soma->t_mudanca = self->relogio;
+}
+
+// soma as métricas do processo morto às dos que saíram da tabela
+static void soma_metricas_morto(so_t *self, processo_t *proc){
+  metricas_processo_t *soma = &self->metricas_mortos;
+  acumula_tempo_mortos(self);
+  acumula_tempo_estado(proc, self->relogio);
+  soma->t_retorno += proc->metricas.t_retorno;
+  soma->preempcoes += proc->metricas.preempcoes;
+  for (int i = 0; i < N_ESTADOS; i++){
+    soma->n_estados[i] += proc->metricas.n_estados[i];
+    soma->t_estados[i] += proc->metricas.t_estados[i];
+  }
+  soma->faltas_de_pagina += proc->metricas.faltas_de_pagina;
+  soma->paginas_retiradas += proc->metricas.paginas_retiradas;
+  soma->paginas_salvas += proc->metricas.paginas_salvas;
+  self->n_mortos++;
+}
+
+// tempo de resposta: tempo médio no estado pronto
+static void calcula_t_resposta(metricas_processo_t *metricas){
+  int n = metricas->n_estados[PRONTO];
+  metricas->t_resposta = n == 0 ? 0 : metricas->t_estados[PRONTO] / n;
+}
+
+// põe em dia as métricas de todos os processos, para serem gravadas
+static void atualiza_metricas_processos(so_t *self){
+  for (int i = 0; i < self->n_slots; i++){
+    processo_t *proc = self->tabela_processos[i];
+    acumula_tempo_estado(proc, self->relogio);
+    calcula_t_resposta(&proc->metricas);
+  }
+  acumula_tempo_mortos(self);
+  calcula_t_resposta(&self->metricas_mortos);
+}
+
+static void inicializa_metricas_so(metricas_so_t *metricas){
+  metricas->t_total = 0;
+  metricas->t_ocioso = 0;
+  metricas->preempcoes = 0;
+  metricas->n_trocas = 0;
+  metricas->t_troca_contexto = 0;
+  metricas->tlb_acertos = 0;
+  metricas->tlb_falhas = 0;
+  for (int i = 0; i < N_IRQ; i++){
+    metricas->n_interrupcoes[i] = 0;
+  }
+}
+
+static void atualiza_metricas_so(so_t *self, int d_tempo){
+  self->metricas.t_total += d_tempo;
+  if (self->processo_corrente == NULL){
+    self->metricas.t_ocioso += d_tempo;
+  }
+}
+
+static void calcula_metricas(so_t *self){
+  int relogio_ant = self->relogio;
+  if (es_le(self->es, D_RELOGIO_INSTRUCOES, &self->relogio) != ERR_OK){
+    console_log(MSG_ERRO, "SO: problema no acesso ao relógio");
+    return;
+  }
+
+  if (relogio_ant != -1){
+    int dif = self->relogio - relogio_ant;
+    atualiza_metricas_so(self, dif);
+  }
+}
+
+static int calcula_preempcoes(so_t *self){
+  int preempcoes = self->metricas_mortos.preempcoes;
+  for (int i = 0; i < self->n_slots; i++){
+    preempcoes += self->tabela_processos[i]->metricas.preempcoes;
+  }
+  return preempcoes;
+}
+
+static void calcula_metricas_paginacao(so_t *self, int *faltas, int *retiradas, int *salvas){
+  metricas_processo_t *mortos = &self->metricas_mortos;
+  *faltas = mortos->faltas_de_pagina;
+  *retiradas = mortos->paginas_retiradas;
+  *salvas = mortos->paginas_salvas;
+  for (int i = 0; i < self->n_slots; i++){
+    metricas_processo_t *metricas = &self->tabela_processos[i]->metricas;
+    *faltas += metricas->faltas_de_pagina;
+    *retiradas += metricas->paginas_retiradas;
+    *salvas += metricas->paginas_salvas;
+  }
+}
+
+// nomes dos estados dos processos, para os arquivos de métricas
+static char *nomes_estados[N_ESTADOS] = {
+  [MORTO]     = "morto",
+  [BLOQUEADO] = "bloqueado",
+  [PRONTO]    = "pronto",
+};
+
+// métricas de um processo (ou somadas, dos mortos que saíram da tabela) em texto
+static void grava_metricas_processo_texto(FILE *arq, metricas_processo_t *metricas){
+  fprintf(arq, "Tempo de retorno: %d\n", metricas->t_retorno);
+  fprintf(arq, "Preempções: %d\n", metricas->preempcoes);
+  fprintf(arq, "Tempo de resposta: %d\n", metricas->t_resposta);
+  fprintf(arq, "Faltas de página: %d\n", metricas->faltas_de_pagina);
+  fprintf(arq, "Páginas retiradas: %d\n", metricas->paginas_retiradas);
+  fprintf(arq, "Páginas salvas: %d\n", metricas->paginas_salvas);
+  for (int j = 0; j < N_ESTADOS; j++){
+    fprintf(arq, "Tempo no estado %d: %d\n", j, metricas->t_estados[j]);
+    fprintf(arq, "Número de vezes no estado %d: %d\n", j, metricas->n_estados[j]);
+  }
+}
+
+// métricas em texto, para leitura humana (só no final da execução)
+static void grava_metricas_texto(so_t *self, FILE *arq){
+  fprintf(arq, "MÉTRICAS DO SO:\n\n");
+  fprintf(arq, "Tempo total: %d\n", self->metricas.t_total);
+  fprintf(arq, "Tempo ocioso: %d\n", self->metricas.t_ocioso);
+  fprintf(arq, "Número de processos: %d\n", self->qnt_processos);
+  fprintf(arq, "Preempções: %d\n", self->metricas.preempcoes);
+  fprintf(arq, "Trocas de contexto: %d\n", self->metricas.n_trocas);
+  fprintf(arq, "Tempo em troca de contexto: %d\n", self->metricas.t_troca_contexto);
+  int faltas, retiradas, salvas;
+  calcula_metricas_paginacao(self, &faltas, &retiradas, &salvas);
+  fprintf(arq, "Substituição de páginas: %s\n", substituicoes[self->config.substituicao].nome);
+  fprintf(arq, "Faltas de página: %d\n", faltas);
+  fprintf(arq, "Páginas retiradas: %d\n", retiradas);
+  fprintf(arq, "Páginas salvas: %d\n", salvas);
+  long traducoes = self->metricas.tlb_acertos + self->metricas.tlb_falhas;
+  fprintf(arq, "Acertos na TLB: %ld\n", self->metricas.tlb_acertos);
+  fprintf(arq, "Falhas na TLB: %ld\n", self->metricas.tlb_falhas);
+  fprintf(arq, "Taxa de acertos na TLB: %.2f%%\n",
+          traducoes == 0 ? 0.0 : 100.0 * self->metricas.tlb_acertos / traducoes);
+
+  for (int i = 0; i < N_IRQ; i++){
+    fprintf(arq, "Interrupção %d: %d\n", i, self->metricas.n_interrupcoes[i]);
+  }
+
+  fprintf(arq, "\nMÉTRICAS DOS PROCESSOS:\n\n");
+  for (int i = 0; i < self->n_slots; i++){
+    processo_t *proc = self->tabela_processos[i];
+    fprintf(arq, "Processo %d\n", proc->process_id);
+    grava_metricas_processo_texto(arq, &proc->metricas);
+    fprintf(arq, "\n");
+  }
+  // processos que saíram da tabela: métricas somadas, tempo de resposta médio
+  if (self->n_mortos > 0){
+    fprintf(arq, "Processos mortos: %d\n", self->n_mortos);
+    grava_metricas_processo_texto(arq, &self->metricas_mortos);
+    fprintf(arq, "\n");
+  }
+}
+
+// escreve uma string no CSV, entre aspas se precisar
+static void csv_str(FILE *arq, char *str){
+  if (strpbrk(str, ",\"\n") == NULL){
+    fputs(str, arq);
+    return;
+  }
+  fputc('"', arq);
+  for (char *c = str; *c != '\0'; c++){
+    if (*c == '"') fputc('"', arq);
+    fputc(*c, arq);
+  }
+  fputc('"', arq);
+}
+
+// processo das linhas do CSV com as métricas somadas dos mortos que saíram
+//   da tabela
+#define PID_MORTOS -1
+
+// uma linha do CSV de métricas: pid 0 para as métricas do SO, PID_MORTOS
+//   para as dos mortos que saíram da tabela; 'item' é o nome da interrupção
+//   ou do estado, para as métricas que têm um por item
+static void csv_linha(so_t *self, FILE *arq, int pid, char *metrica, char *item, long valor){
+  fprintf(arq, "%d,", self->relogio);
+  if (pid > 0) fprintf(arq, "%d", pid);
+  if (pid == PID_MORTOS) fprintf(arq, "mortos");
+  fprintf(arq, ",%s,", metrica);
+  if (item != NULL) csv_str(arq, item);
+  fprintf(arq, ",%ld\n", valor);
+}
+
+// métricas de um processo (ou somadas, dos mortos que saíram da tabela) em CSV
+static void grava_metricas_processo_csv(so_t *self, FILE *arq, int pid,
+                                        metricas_processo_t *metricas){
+  csv_linha(self, arq, pid, "t_retorno", NULL, metricas->t_retorno);
+  csv_linha(self, arq, pid, "preempcoes", NULL, metricas->preempcoes);
+  csv_linha(self, arq, pid, "t_resposta", NULL, metricas->t_resposta);
+  csv_linha(self, arq, pid, "faltas_de_pagina", NULL, metricas->faltas_de_pagina);
+  csv_linha(self, arq, pid, "paginas_retiradas", NULL, metricas->paginas_retiradas);
+  csv_linha(self, arq, pid, "paginas_salvas", NULL, metricas->paginas_salvas);
+  for (int j = 0; j < N_ESTADOS; j++){
+    csv_linha(self, arq, pid, "t_estado", nomes_estados[j], metricas->t_estados[j]);
+    csv_linha(self, arq, pid, "n_estado", nomes_estados[j], metricas->n_estados[j]);
+  }
+}
+
+// métricas em CSV, uma linha por métrica
+static void grava_metricas_csv(so_t *self, FILE *arq){
+  csv_linha(self, arq, 0, "t_total", NULL, self->metricas.t_total);
+  csv_linha(self, arq, 0, "t_ocioso", NULL, self->metricas.t_ocioso);
+  csv_linha(self, arq, 0, "n_processos", NULL, self->qnt_processos);
+  csv_linha(self, arq, 0, "preempcoes", NULL, self->metricas.preempcoes);
+  csv_linha(self, arq, 0, "n_trocas", NULL, self->metricas.n_trocas);
+  csv_linha(self, arq, 0, "t_troca_contexto", NULL, self->metricas.t_troca_contexto);
+  int faltas, retiradas, salvas;
+  calcula_metricas_paginacao(self, &faltas, &retiradas, &salvas);
+  csv_linha(self, arq, 0, "substituicao", substituicoes[self->config.substituicao].nome,
+            self->config.substituicao);
+  csv_linha(self, arq, 0, "faltas_de_pagina", NULL, faltas);
+  csv_linha(self, arq, 0, "paginas_retiradas", NULL, retiradas);
+  csv_linha(self, arq, 0, "paginas_salvas", NULL, salvas);
+  csv_linha(self, arq, 0, "tlb_acertos", NULL, self->metricas.tlb_acertos);
+  csv_linha(self, arq, 0, "tlb_falhas", NULL, self->metricas.tlb_falhas);
+  for (int i = 0; i < N_IRQ; i++){
+    csv_linha(self, arq, 0, "n_interrupcoes", irq_nome(i), self->metricas.n_interrupcoes[i]);
+  }
+  for (int i = 0; i < self->n_slots; i++){
+    processo_t *proc = self->tabela_processos[i];
+    int pid = proc->process_id;
+    csv_linha(self, arq, pid, "estado", nomes_estados[proc->estado], proc->estado);
+    grava_metricas_processo_csv(self, arq, pid, &proc->metricas);
+  }
+  if (self->n_mortos > 0){
+    csv_linha(self, arq, PID_MORTOS, "n_processos", NULL, self->n_mortos);
+    grava_metricas_processo_csv(self, arq, PID_MORTOS, &self->metricas_mortos);
+  }
+}
+
+// escreve uma string JSON (os nomes usados não têm caracteres de controle)
+static void json_str(FILE *arq, char *str){
+  fputc('"', arq);
+  for (char *c = str; *c != '\0'; c++){
+    if (*c == '"' || *c == '\\') fputc('\\', arq);
+    fputc(*c, arq);
+  }
+  fputc('"', arq);
+}
+
+// escreve um objeto JSON com um valor para cada estado de processo
+static void json_por_estado(FILE *arq, int valores[N_ESTADOS]){
+  fprintf(arq, "{");
+  for (int j = 0; j < N_ESTADOS; j++){
+    if (j > 0) fprintf(arq, ",");
+    json_str(arq, nomes_estados[j]);
+    fprintf(arq, ":%d", valores[j]);
+  }
+  fprintf(arq, "}");
+}
+
+// métricas de um processo (ou somadas, dos mortos que saíram da tabela) em
+//   JSON, os campos sem as chaves do objeto
+static void grava_metricas_processo_json(FILE *arq, metricas_processo_t *metricas){
+  fprintf(arq, "\"t_retorno\":%d,\"preempcoes\":%d,\"t_resposta\":%d,",
+          metricas->t_retorno, metricas->preempcoes, metricas->t_resposta);
+  fprintf(arq, "\"faltas_de_pagina\":%d,\"paginas_retiradas\":%d,\"paginas_salvas\":%d,",
+          metricas->faltas_de_pagina, metricas->paginas_retiradas,
+          metricas->paginas_salvas);
+  fprintf(arq, "\"t_estados\":");
+  json_por_estado(arq, metricas->t_estados);
+  fprintf(arq, ",\"n_estados\":");
+  json_por_estado(arq, metricas->n_estados);
+}
+
+// métricas em JSON, um objeto por linha (JSON Lines), para poder ser lido
+//   amostra a amostra enquanto o arquivo ainda está sendo escrito
+static void grava_metricas_json(so_t *self, FILE *arq, bool final){
+  fprintf(arq, "{\"instante\":%d,\"final\":%s,\"so\":{", self->relogio,
+          final ? "true" : "false");
+  fprintf(arq, "\"t_total\":%d,\"t_ocioso\":%d,\"n_processos\":%d,\"preempcoes\":%d,",
+          self->metricas.t_total, self->metricas.t_ocioso, self->qnt_processos,
+          self->metricas.preempcoes);
+  fprintf(arq, "\"n_trocas\":%d,\"t_troca_contexto\":%d,",
+          self->metricas.n_trocas, self->metricas.t_troca_contexto);
+  int faltas, retiradas, salvas;
+  calcula_metricas_paginacao(self, &faltas, &retiradas, &salvas);
+  fprintf(arq, "\"substituicao\":");
+  json_str(arq, substituicoes[self->config.substituicao].nome);
+  fprintf(arq, ",\"faltas_de_pagina\":%d,\"paginas_retiradas\":%d,\"paginas_salvas\":%d,",
+          faltas, retiradas, salvas);
+  fprintf(arq, "\"tlb_acertos\":%ld,\"tlb_falhas\":%ld,",
+          self->metricas.tlb_acertos, self->metricas.tlb_falhas);
+  fprintf(arq, "\"n_interrupcoes\":{");
+  for (int i = 0; i < N_IRQ; i++){
+    if (i > 0) fprintf(arq, ",");
+    json_str(arq, irq_nome(i));
+    fprintf(arq, ":%d", self->metricas.n_interrupcoes[i]);
+  }
+  fprintf(arq, "}},\"processos\":[");
+  for (int i = 0; i < self->n_slots; i++){
+    processo_t *proc = self->tabela_processos[i];
+    if (i > 0) fprintf(arq, ",");
+    fprintf(arq, "{\"pid\":%d,\"estado\":", proc->process_id);
+    json_str(arq, nomes_estados[proc->estado]);
+    fprintf(arq, ",");
+    grava_metricas_processo_json(arq, &proc->metricas);
+    fprintf(arq, "}");
+  }
+  // os mortos que saíram da tabela, somados
+  fprintf(arq, "],\"mortos\":{\"n_processos\":%d,", self->n_mortos);
+  grava_metricas_processo_json(arq, &self->metricas_mortos);
+  fprintf(arq, "}}\n");
+}
+
+// grava as métricas no arquivo, no formato configurado: uma amostra durante
+//   a execução, ou as métricas finais ('final'), quando o arquivo é fechado
+// o formato texto só é gravado no final
+static void grava_metricas(so_t *self, bool final){
+  formato_metricas_t formato = self->config.formato_metricas;
+  if (!final && formato == METRICAS_TEXTO) return;
+  atualiza_metricas_processos(self);
+  self->metricas.preempcoes = calcula_preempcoes(self);
+  mmu_tlb_estatisticas(self->mmu, &self->metricas.tlb_acertos, &self->metricas.tlb_falhas);
+  if (self->arq_metricas == NULL){
+    static char *extensoes[N_FORMATOS_METRICAS] = { "txt", "csv", "json" };
+    char nome[100];
+    char *arq_metricas = self->config.arq_metricas;
+    if (arq_metricas == NULL){
+      sprintf(nome, "../Metricas/metricas_so_%d.%s", self->config.escalonador,
+              extensoes[formato]);
+      arq_metricas = nome;
+    }
+    self->arq_metricas = fopen(arq_metricas, "w");
+    if (self->arq_metricas == NULL){
+      console_log(MSG_ERRO, "SO: problema na abertura do arquivo de métricas");
+      return;
+    }
+    if (formato == METRICAS_CSV){
+      fprintf(self->arq_metricas, "instante,processo,metrica,item,valor\n");
+    }
+  }
+  switch (formato){
+    case METRICAS_TEXTO:
+      grava_metricas_texto(self, self->arq_metricas);
+      break;
+    case METRICAS_CSV:
+      grava_metricas_csv(self, self->arq_metricas);
+      break;
+    default:
+      grava_metricas_json(self, self->arq_metricas, final);
+  }
+  fflush(self->arq_metricas);
+  if (final){
+    fclose(self->arq_metricas);
+    self->arq_metricas = NULL;
+  }
+}
+
+static processo_t *cria_processo(int process_id, int reg_pc){
+  processo_t *processo = malloc(sizeof(processo_t));
+  assert(processo != NULL);
+
+  processo->process_id = process_id;
+  processo->slot = -1;
+
+  processo->reg_a = 0;
+  processo->reg_x = 0;
+  processo->reg_pc = reg_pc;
+  processo->reg_erro = ERR_OK;
+  processo->reg_complemento = 0;
+
+  processo->estado = PRONTO;
+  processo->razao = OK;
+
+  processo->prioridade = 0.5;
+  processo->nivel = 0;
+  processo->fila_ant = NULL;
+  processo->fila_prox = NULL;
+  processo->na_fila = false;
+  processo->esperas.ini = NULL;
+  processo->esperas.fim = NULL;
+  processo->em_espera = NULL;
+  processo->espera_ant = NULL;
+  processo->espera_prox = NULL;
+  processo->dado_escrita = 0;
+
+  processo->terminal = (process_id % 4) * 4;
+
+  // todas as páginas começam inválidas, vão para a memória principal por demanda
+  processo->tabpag = tabpag_cria();
+  processo->bloco_disco = 0;
+  processo->n_pedidos_disco = 0;
+  processo->n_paginas = 0;
+  processo->pagina_em_falta = -1;
+  processo->falta_adiada = false;
+
+  inicializa_metricas_processo(&processo->metricas);
+
+  return processo;
+}
+
+static int tam_fila(so_t *self){
+  return self->n_prontos;
+}
+
+// chave do processo na fila de prioridade dos prontos: o nível no escalonador
+//   de múltiplas filas (processos do mesmo nível saem na ordem de chegada),
+//   a prioridade nos outros
+static float chave_pronto(so_t *self, processo_t *proc){
+  if (self->config.escalonador == 3) return proc->nivel;
+  return proc->prioridade;
+}
+
+// o primeiro da fila de prioridade dos prontos (NULL se estiver vazia)
+static processo_t *primeiro_pronto(so_t *self){
+  int slot = fila_prio_primeiro(self->prontos_prio);
+  if (slot < 0) return NULL;
+  return self->tabela_processos[slot];
+}
+
+static void remove_fila(so_t *self, int process_id){
+  processo_t *proc = busca_processo(self, process_id);
+  if (proc == NULL || !proc->na_fila) return;
+
+  if (proc->fila_ant != NULL) {
+    proc->fila_ant->fila_prox = proc->fila_prox;
+  } else {
+    self->fila_ini = proc->fila_prox;
+  }
+  if (proc->fila_prox != NULL) {
+    proc->fila_prox->fila_ant = proc->fila_ant;
+  } else {
+    self->fila_fim = proc->fila_ant;
+  }
+  proc->fila_ant = NULL;
+  proc->fila_prox = NULL;
+  proc->na_fila = false;
+  self->n_prontos--;
+  fila_prio_remove(self->prontos_prio, proc->slot);
+}
+
+static void mata_processo(so_t *self, int process_id){
+  processo_t *proc = busca_processo(self, process_id);
+  if (proc == NULL || proc->estado == MORTO) return;
+  acumula_tempo_estado(proc, self->relogio);
+  proc->estado = MORTO;
+  proc->metricas.n_estados[proc->estado]++;
+
+  remove_fila(self, process_id);
+  sai_da_espera(proc);
+  acorda_esperas(self, proc);
+  so_libera_memoria_processo(self, proc);
+  self->n_vivos--;
+  if (proc->n_pedidos_disco == 0) libera_slot(self, proc);
+}
+
+static processo_t *busca_processo(so_t *self, int process_id){
+  int slot = mapa_busca(self->slot_do_pid, process_id);
+  if (slot < 0) return NULL;
+
+  return self->tabela_processos[slot];
+}
+
+// retorna true se o processo já existiu e morreu (esteja ou não na tabela)
+static bool processo_morto(so_t *self, int process_id){
+  processo_t *proc = busca_processo(self, process_id);
+  if (proc == NULL) return process_id > 0 && process_id < self->id_processo;
+  return proc->estado == MORTO;
+}
+
+// a posição do processo morto pode ser usada por outro
+static void libera_slot(so_t *self, processo_t *proc){
+  self->slots_livres[self->n_livres++] = proc->slot;
+}
+
+// tira da tabela o processo morto, somando as métricas dele às dos mortos
+//   que já saíram, e libera o descritor
+static void descarta_morto(so_t *self, processo_t *proc){
+  soma_metricas_morto(self, proc);
+  mapa_remove(self->slot_do_pid, proc->process_id);
+  free(proc);
+}
+
+// coloca o processo na tabela, na posição de um morto se tiver alguma livre
+static void insere_processo(so_t *self, processo_t *proc){
+  int slot;
+  if (self->n_livres > 0){
+    slot = self->slots_livres[--self->n_livres];
+    descarta_morto(self, self->tabela_processos[slot]);
+  } else {
+    if (self->n_slots == self->max_processos){
+      self->max_processos = self->max_processos * 2;
+      self->tabela_processos = realloc(self->tabela_processos, self->max_processos * sizeof(*self->tabela_processos));
+      self->slots_livres = realloc(self->slots_livres, self->max_processos * sizeof(*self->slots_livres));
+      assert(self->tabela_processos != NULL && self->slots_livres != NULL);
+    }
+    slot = self->n_slots++;
+  }
+  self->tabela_processos[slot] = proc;
+  proc->slot = slot;
+  mapa_insere(self->slot_do_pid, proc->process_id, slot);
+  self->n_vivos++;
+}
+
+static processo_t *so_adiciona_processo(so_t *self, char *nome_do_executavel){
+  // o processo tem que existir antes da carga, que é feita na memória dele
+  processo_t *processo = cria_processo(self->id_processo, 0);
+  processo->metricas.t_mudanca = self->relogio;
+
+  int ender = so_carrega_programa(self, processo, nome_do_executavel);
+
+  if (ender < 0) {
+    tabpag_destroi(processo->tabpag);
+    free(processo);
+    return NULL;
+  }
+  processo->reg_pc = ender;
+
+  insere_processo(self, processo);
+  ajusta_fila(self, processo);
+
+  self->qnt_processos++;
+  self->id_processo++;
+
+  return processo;
+}
+
+static void muda_estado_processo(so_t *self, processo_t *proc, process_estado_t estado, process_r_bloq_t razao){
+  acumula_tempo_estado(proc, self->relogio);
+  proc->estado = estado;
+  proc->razao = razao;
+  proc->metricas.n_estados[proc->estado]++;
+}
 
 // CRIAÇÃO {{{1
 
+void so_config_padrao(so_config_t *config)
+{
+  config->escalonador = ESCALONADOR;
+  config->quantum = QUANTUM;
+  config->intervalo_interrupcao = INTERVALO_INTERRUPCAO;
+  config->substituicao = SUBSTITUICAO;
+  config->arq_metricas = NULL;
+  config->programa_inicial = "init.maq";
+  config->formato_metricas = METRICAS_TEXTO;
+  config->intervalo_amostras = 0;
+  config->custo_troca = 0;
+  config->disco_t_busca = DISCO_T_BUSCA;
+  config->disco_t_transferencia = DISCO_T_TRANSFERENCIA;
+}
+
+bool so_config_valida(so_config_t *config)
+{
+  if (config->escalonador < 0 || config->escalonador >= N_ESCALONADORES) return false;
+  if (config->quantum <= 0 || config->intervalo_interrupcao <= 0) return false;
+  if (config->formato_metricas < 0 || config->formato_metricas >= N_FORMATOS_METRICAS) return false;
+  if (config->intervalo_amostras < 0) return false;
+  if (config->custo_troca < 0) return false;
+  if (config->disco_t_busca < 0 || config->disco_t_transferencia < 0) return false;
+  if (config->substituicao < 0 || config->substituicao >= N_SUBSTITUICOES) return false;
+  return true;
+}
 
 so_t *so_cria(cpu_t *cpu, mem_t *mem, mmu_t *mmu,
-              es_t *es, console_t *console)
+              es_t *es, console_t *console, so_config_t *config)
 {
   so_t *self = malloc(sizeof(*self));
   assert(self != NULL);
@@ -86,47 +947,112 @@ so_t *so_cria(cpu_t *cpu, mem_t *mem, mmu_t *mmu,
   self->es = es;
   self->console = console;
   self->erro_interno = false;
+  self->config = *config;
+
+  self->id_processo = 1;
+  self->qnt_processos = 0;
+  self->n_vivos = 0;
+  self->n_slots = 0;
+  self->max_processos = TAM_TABELA_PROCESSOS;
+  self->processo_corrente = NULL;
+  self->tabela_processos = malloc(self->max_processos * sizeof(processo_t *));
+  self->slots_livres = malloc(self->max_processos * sizeof(int));
+  self->n_livres = 0;
+  self->slot_do_pid = mapa_cria();
+  inicializa_metricas_processo(&self->metricas_mortos);
+  self->metricas_mortos.n_estados[PRONTO] = 0;
+  self->n_mortos = 0;
+
+  assert(self->tabela_processos != NULL && self->slots_livres != NULL);
+  self->fila_ini = NULL;
+  self->fila_fim = NULL;
+  self->n_prontos = 0;
+  for (int i = 0; i < N_TERMINAIS; i++) {
+    self->esperas_teclado[i] = (fila_espera_t){ NULL, NULL };
+    self->esperas_tela[i] = (fila_espera_t){ NULL, NULL };
+  }
+  self->prontos_prio = fila_prio_cria();
+  self->ultimo_boost = 0;
+  self->quantum = self->config.quantum;
+
+  // as 100 primeiras posições da memória (pelo menos) são do SO, os quadros
+  //   a partir do seguinte ao que contém o endereço 99 são para os processos
+  self->n_quadros = mem_tam(self->mem) / TAM_PAGINA;
+  self->quadro_ini = PAGINA_DO_END(99) + 1;
+  self->quadros = malloc(self->n_quadros * sizeof(*self->quadros));
+  assert(self->quadros != NULL);
+  for (int quadro = 0; quadro < self->n_quadros; quadro++) {
+    self->quadros[quadro].processo = NULL;
+    self->quadros[quadro].em_transferencia = false;
+  }
+  self->n_cargas = 0;
+  self->n_faltas = 0;
+  self->proc_em_falta = NULL;
+  self->ponteiro = self->quadro_ini;
+  self->tam_pedidos = 2 * self->n_quadros;
+  self->pedidos = malloc(self->tam_pedidos * sizeof(*self->pedidos));
+  assert(self->pedidos != NULL);
+  self->ini_pedidos = 0;
+  self->n_pedidos = 0;
+
+  // o disco guarda as páginas dos processos, um bloco por página
+  self->bloco_livre = 0;
+  int tam_disco;
+  if (es_le(self->es, D_DISCO_TAMANHO, &tam_disco) != ERR_OK) {
+    console_log(MSG_ERRO, "SO: problema no acesso ao disco");
+    self->erro_interno = true;
+    tam_disco = 0;
+  }
+  self->n_blocos = tam_disco / TAM_PAGINA;
+
+  self->relogio = -1;
+
+  inicializa_metricas_so(&self->metricas);
+  self->arq_metricas = NULL;
+  self->proxima_amostra = self->config.intervalo_amostras;
 
   // quando a CPU executar uma instrução CHAMAC, deve chamar a função
   //   so_trata_interrupcao, com primeiro argumento um ptr para o SO
   cpu_define_chamaC(self->cpu, so_trata_interrupcao, self);
 
-  // coloca o tratador de interrupção na memória
-  // quando a CPU aceita uma interrupção, passa para modo supervisor, 
-  //   salva seu estado à partir do endereço 0, e desvia para o endereço
-  //   IRQ_END_TRATADOR
-  // colocamos no endereço IRQ_END_TRATADOR o programa de tratamento
-  //   de interrupção (escrito em asm). esse programa deve conter a 
-  //   instrução CHAMAC, que vai chamar so_trata_interrupcao (como
-  //   foi definido acima)
-  int ender = so_carrega_programa(self, NENHUM_PROCESSO, "trata_int.maq");
+  if (!so_config_valida(&self->config)) {
+    console_log(MSG_ERRO, "SO: configuração inválida");
+    self->erro_interno = true;
+  }
+
+  // coloca o tratador de interrupção na memória física
+  int ender = so_carrega_programa(self, NULL, "trata_int.maq");
   if (ender != IRQ_END_TRATADOR) {
-    console_printf("SO: problema na carga do programa de tratamento de interrupção");
+    console_log(MSG_ERRO, "SO: problema na carga do programa de tratamento de interrupção");
     self->erro_interno = true;
   }
 
-  // programa o relógio para gerar uma interrupção após INTERVALO_INTERRUPCAO
-  if (es_escreve(self->es, D_RELOGIO_TIMER, INTERVALO_INTERRUPCAO) != ERR_OK) {
-    console_printf("SO: problema na programação do timer");
+  // programa o relógio para gerar uma interrupção após o intervalo configurado
+  if (es_escreve(self->es, D_RELOGIO_TIMER, self->config.intervalo_interrupcao) != ERR_OK) {
+    console_log(MSG_ERRO, "SO: problema na programação do timer");
     self->erro_interno = true;
   }
 
-  // inicializa a tabela de páginas global, e entrega ela para a MMU
-  // t2: com processos, essa tabela não existiria, teria uma por processo, que
-  //     deve ser colocada na MMU quando o processo é despachado para execução
-  self->tabpag_global = tabpag_cria();
-  mmu_define_tabpag(self->mmu, self->tabpag_global);
-  // define o primeiro quadro livre de memória como o seguinte àquele que
-  //   contém o endereço 99 (as 100 primeiras posições de memória (pelo menos)
-  //   não vão ser usadas por programas de usuário)
-  // t2: o controle de memória livre deve ser mais aprimorado que isso  
-  self->quadro_livre = 99 / TAM_PAGINA + 1;
   return self;
 }
 
 void so_destroi(so_t *self)
 {
   cpu_define_chamaC(self->cpu, NULL, NULL);
+  fila_prio_destroi(self->prontos_prio);
+  // a execução terminou antes do fim do SO, o arquivo fica com as amostras
+  if (self->arq_metricas != NULL) fclose(self->arq_metricas);
+  mmu_define_tabpag(self->mmu, NULL);
+  for (int i = 0; i < self->n_slots; i++) {
+    processo_t *proc = self->tabela_processos[i];
+    if (proc->tabpag != NULL) tabpag_destroi(proc->tabpag);
+    free(proc);
+  }
+  free(self->tabela_processos);
+  free(self->slots_livres);
+  mapa_destroi(self->slot_do_pid);
+  free(self->quadros);
+  free(self->pedidos);
   free(self);
 }
 
@@ -138,74 +1064,439 @@ static void so_salva_estado_da_cpu(so_t *self);
 static void so_trata_irq(so_t *self, int irq);
 static void so_trata_pendencias(so_t *self);
 static void so_escalona(so_t *self);
+
 static int so_despacha(so_t *self);
+static void so_troca_contexto(so_t *self, processo_t *anterior);
+
+static bool tudo_morreu(so_t *self){
+  return self->n_vivos == 0;
+}
+
+static int finaliza_so(so_t *self){
+  err_t e1, e2;
+  e1 = es_escreve(self->es, D_RELOGIO_TIMER, 0);
+  e2 = es_escreve(self->es, D_RELOGIO_INTERRUPCAO, 0);
+  if (e1 != ERR_OK || e2 != ERR_OK)
+  {
+    console_log(MSG_ERRO, "SO: nao consigo desligar o timer!!");
+    self->erro_interno = true;
+  }
+
+  grava_metricas(self, true);
+
+  return 1;
+}
+
+
+// função a ser chamada pela CPU quando executa a instrução CHAMAC, no tratador de
+//   interrupção em assembly
+// essa é a única forma de entrada no SO depois da inicialização
+// o valor retornado por esta função é colocado no registrador A, e é usado
+//   pelo tratador de interrupção para decidir se a CPU deve retornar da
+//   interrupção (e executar o código de usuário) ou executar PARA e ficar
+//   suspensa até receber outra interrupção
+static int so_trata_interrupcao(void *argC, int reg_A)
+{
+  so_t *self = argC;
+  irq_t irq = reg_A;
+  processo_t *anterior = self->processo_corrente;
+
+  self->metricas.n_interrupcoes[irq]++;
+
+  calcula_metricas(self);
+  if (self->config.intervalo_amostras > 0 && self->relogio >= self->proxima_amostra){
+    grava_metricas(self, false);
+    self->proxima_amostra = self->relogio + self->config.intervalo_amostras;
+  }
+
+  // salva o estado da cpu no descritor do processo que foi interrompido
+  so_salva_estado_da_cpu(self);
+  // faz o atendimento da interrupção
+  so_trata_irq(self, irq);
+  // faz o processamento independente da interrupção
+  so_trata_pendencias(self);
+  // escolhe o próximo processo a executar
+  so_escalona(self);
+  // cobra a troca, se o processo escolhido não é o que foi interrompido
+  so_troca_contexto(self, anterior);
+  // recupera o estado do processo escolhido
+
+  // sem processo vivo, ou com um erro do qual o SO não se recupera (como
+  //   uma falta de página que nunca vai poder ser atendida), a simulação acaba
+  if (!tudo_morreu(self) && !self->erro_interno){
+    return so_despacha(self);
+  }
+  else{
+    return finaliza_so(self);
+  }
+}
+
+static void so_salva_estado_da_cpu(so_t *self)
+{
+  processo_t *proc = self->processo_corrente;
+
+  if (proc == NULL) return;
+
+  int pc, a, x, erro, complemento;
+
+  mem_le(self->mem, IRQ_END_PC, &pc);
+  mem_le(self->mem, IRQ_END_A, &a);
+  mem_le(self->mem, IRQ_END_X, &x);
+  mem_le(self->mem, IRQ_END_erro, &erro);
+  mem_le(self->mem, IRQ_END_complemento, &complemento);
+
+  proc->reg_pc = pc;
+  proc->reg_a = a;
+  proc->reg_x = x;
+  proc->reg_erro = erro;
+  proc->reg_complemento = complemento;
+
+  // a instrução que causou a falta de página foi executada
+  if (proc->pagina_em_falta >= 0 && pc != proc->pc_em_falta) {
+    proc->pagina_em_falta = -1;
+  }
+}
+
+// função que ajusta a fila de processos, coloca o processo no fim da fila
+static void ajusta_fila(so_t *self, processo_t *proc){
+  if (proc->na_fila) return;
+  proc->fila_ant = self->fila_fim;
+  proc->fila_prox = NULL;
+  if (self->fila_fim != NULL) {
+    self->fila_fim->fila_prox = proc;
+  } else {
+    self->fila_ini = proc;
+  }
+  self->fila_fim = proc;
+  proc->na_fila = true;
+  self->n_prontos++;
+  fila_prio_insere(self->prontos_prio, proc->slot, chave_pronto(self, proc));
+}
+
+// coloca o processo no fim da fila de espera
+static void entra_na_espera(processo_t *proc, fila_espera_t *fila){
+  proc->em_espera = fila;
+  proc->espera_ant = fila->fim;
+  proc->espera_prox = NULL;
+  if (fila->fim != NULL) {
+    fila->fim->espera_prox = proc;
+  } else {
+    fila->ini = proc;
+  }
+  fila->fim = proc;
+}
+
+// tira o processo da fila de espera em que está (se estiver em alguma)
+static void sai_da_espera(processo_t *proc){
+  fila_espera_t *fila = proc->em_espera;
+  if (fila == NULL) return;
+  if (proc->espera_ant != NULL) {
+    proc->espera_ant->espera_prox = proc->espera_prox;
+  } else {
+    fila->ini = proc->espera_prox;
+  }
+  if (proc->espera_prox != NULL) {
+    proc->espera_prox->espera_ant = proc->espera_ant;
+  } else {
+    fila->fim = proc->espera_ant;
+  }
+  proc->em_espera = NULL;
+  proc->espera_ant = NULL;
+  proc->espera_prox = NULL;
+}
+
+// fila dos pedidos que esperam o teclado (razao LEITURA) ou a tela (ESCRITA)
+//   do terminal
+static fila_espera_t *fila_do_terminal(so_t *self, int terminal, process_r_bloq_t razao){
+  if (razao == LEITURA) return &self->esperas_teclado[terminal / 4];
+  return &self->esperas_tela[terminal / 4];
+}
+
+// atende o pedido de leitura do processo, se o teclado tiver um caractere;
+//   retorna false se não tiver
+static bool trata_le(so_t *self, processo_t *proc){
+  int estado;
+  int terminal = proc->terminal;
+
+  if (es_le(self->es, terminal_processo(terminal, TECLADO_OK), &estado) == ERR_OK && estado != 0) {
+    sai_da_espera(proc);
+    muda_estado_processo(self, proc, PRONTO, OK);
+    ajusta_fila(self, proc);
+    console_log(MSG_DETALHE, "SO: desbloqueado processo %d - leitura", proc->process_id);
+
+    int dado;
+    es_le(self->es, terminal_processo(terminal, TECLADO), &dado);
+    proc->reg_a = dado;
+    return true;
+  }
+  return false;
+}
+
+// atende o pedido de escrita do processo, se a tela puder receber um
+//   caractere; retorna false se não puder
+static bool trata_escreve(so_t *self, processo_t *proc){
+  int estado;
+  int terminal = proc->terminal;
+
+  if (es_le(self->es, terminal_processo(terminal, TELA_OK), &estado) == ERR_OK && estado != 0) {
+    int dado = proc->dado_escrita;
+    if (es_escreve(self->es, terminal_processo(terminal, TELA), dado) == ERR_OK) {
+      sai_da_espera(proc);
+      muda_estado_processo(self, proc, PRONTO, OK);
+      proc->reg_a = 0;
+      ajusta_fila(self, proc);
+      console_log(MSG_DETALHE, "SO: desbloqueado processo %d - escrita", proc->process_id);
+      return true;
+    }
+  }
+  return false;
+}
+
+// habilita ou desabilita a interrupção de um terminal (dispositivo
+//   TECLADO_INT ou TELA_INT)
+static void so_liga_int_terminal(so_t *self, int dispositivo, bool liga)
+{
+  if (es_escreve(self->es, dispositivo, liga ? 1 : 0) != ERR_OK) {
+    console_log(MSG_ERRO, "SO: problema no acesso à interrupção do terminal");
+    self->erro_interno = true;
+  }
+}
+
+// atende, na ordem de chegada, os pedidos que esperam para ler (razao
+//   LEITURA) ou escrever (ESCRITA) no terminal, enquanto o dispositivo estiver
+//   pronto; se nenhum continuar esperando, a interrupção correspondente é
+//   desabilitada
+static void so_atende_terminal(so_t *self, int terminal, process_r_bloq_t razao)
+{
+  fila_espera_t *fila = fila_do_terminal(self, terminal, razao);
+  while (fila->ini != NULL) {
+    bool atendido;
+    if (razao == LEITURA) {
+      atendido = trata_le(self, fila->ini);
+    } else {
+      atendido = trata_escreve(self, fila->ini);
+    }
+    if (!atendido) break;
+  }
+  if (fila->ini == NULL) {
+    int dispositivo = (razao == LEITURA) ? TECLADO_INT(terminal) : TELA_INT(terminal);
+    so_liga_int_terminal(self, dispositivo, false);
+  }
+}
+
+// desbloqueia os processos que esperavam 'proc', que morreu
+static void acorda_esperas(so_t *self, processo_t *proc){
+  while (proc->esperas.ini != NULL){
+    processo_t *espera = proc->esperas.ini;
+    sai_da_espera(espera);
+    muda_estado_processo(self, espera, PRONTO, OK);
+    espera->reg_a = 0;
+    ajusta_fila(self, espera);
+    console_log(MSG_DETALHE, "SO: desbloqueado processo %d - espera", espera->process_id);
+  }
+}
+
+static void so_trata_pendencias(so_t *self)
+{
+  // nada a fazer: os processos que esperam outro morrer são desbloqueados
+  //   em mata_processo, e os que esperam o terminal na interrupção dele
+}
+
+static void calcula_prioridade(so_t *self, processo_t *proc){
+  if (proc == NULL) return;
+  proc->prioridade = (proc->prioridade + (self->config.quantum - self->quantum) / (float)self->config.quantum) / 2;
+  // só a chave deste processo mudou, é reposicionado na fila de prioridade
+  fila_prio_altera(self->prontos_prio, proc->slot, chave_pronto(self, proc));
+}
+
+static void so_escalona(so_t *self){
+
+  calcula_prioridade(self, self->processo_corrente);
+
+  if(self->config.escalonador >= 0 && self->config.escalonador < N_ESCALONADORES){
+    escalonadores[self->config.escalonador](self);
+  }
+  else{
+    console_log(MSG_ERRO, "SO: escalonador não implementado.");
+    self->erro_interno = true;
+  }
+}
+
+static processo_t *proximo(so_t *self){
+  for (int i = 0; i < self->n_slots; i++){
+    if (self->tabela_processos[i]->estado == PRONTO){
+      return self->tabela_processos[i];
+    }
+  }
+  return NULL;
+}
+
+// só é chamada quando não tem processo pronto: os vivos estão todos bloqueados
+static bool tem_bloqueado(so_t *self){
+  return self->n_vivos > 0;
+}
+
+static void so_escalona_simples(so_t *self)
+{
+  if (self->processo_corrente != NULL && self->processo_corrente->estado == PRONTO) {
+    return;
+  }
+
+  processo_t *prox = proximo(self);
+  if (prox != NULL){
+    self->processo_corrente = prox;
+    return;
+  }
+
+  if (tem_bloqueado(self)){
+    self->processo_corrente = NULL;
+  }
+  else{
+    console_printf("SO: todos processos foram executados.");
+    self->erro_interno = true;
+  }
+}
+
+static void ajusta_fila_pronto(so_t *self, processo_t *proc){
+  remove_fila(self, proc->process_id);
+  ajusta_fila(self, proc);
+  self->processo_corrente = NULL;
+}
+
+static void so_escalona_round_robin(so_t *self){
+  if (self->processo_corrente != NULL && self->processo_corrente->estado == PRONTO && self->quantum > 0){
+    return;
+  }
+
+  if (self->processo_corrente != NULL && self->processo_corrente->estado == PRONTO && self->quantum == 0){
+    self->processo_corrente->metricas.preempcoes++;
+    ajusta_fila_pronto(self, self->processo_corrente);
+  }
+
+  if (tam_fila(self) != 0) {
+    self->processo_corrente = self->fila_ini;
+    self->quantum = self->config.quantum;
+    return;
+  }
+
+  if (tem_bloqueado(self)){
+    self->processo_corrente = NULL;
+  }
+  else{
+    console_printf("SO: todos processos foram executados.");
+    self->erro_interno = true;
+  }
+}
+
+static void so_escalona_prioridade(so_t *self){
+  if (self->processo_corrente != NULL && self->processo_corrente->estado == PRONTO && self->quantum > 0){
+    return;
+  }
+
+  if (self->processo_corrente != NULL && self->processo_corrente->estado == PRONTO && self->quantum == 0){
+    self->processo_corrente->metricas.preempcoes++;
+    ajusta_fila_pronto(self, self->processo_corrente);
+  }
+
+  if (tam_fila(self) != 0) {
+    self->processo_corrente = primeiro_pronto(self);
+    self->quantum = self->config.quantum;
+    return;
+  }
 
-// função a ser chamada pela CPU quando executa a instrução CHAMAC, no tratador de
-//   interrupção em assembly
-// essa é a única forma de entrada no SO depois da inicialização
-// na inicialização do SO, a CPU foi programada para chamar esta função para executar
-//   a instrução CHAMAC
-// a instrução CHAMAC só deve ser executada pelo tratador de interrupção
-//
-// o primeiro argumento é um ponteiro para o SO, o segundo é a identificação
-//   da interrupção
-// o valor retornado por esta função é colocado no registrador A, e pode ser
-//   testado pelo código que está após o CHAMAC. No tratador de interrupção em
-//   assembly esse valor é usado para decidir se a CPU deve retornar da interrupção
-//   (e executar o código de usuário) ou executar PARA e ficar suspensa até receber
-//   outra interrupção
-static int so_trata_interrupcao(void *argC, int reg_A)
-{
-  so_t *self = argC;
-  irq_t irq = reg_A;
-  // esse print polui bastante, recomendo tirar quando estiver com mais confiança
-  console_printf("SO: recebi IRQ %d (%s)", irq, irq_nome(irq));
-  // salva o estado da cpu no descritor do processo que foi interrompido
-  so_salva_estado_da_cpu(self);
-  // faz o atendimento da interrupção
-  so_trata_irq(self, irq);
-  // faz o processamento independente da interrupção
-  so_trata_pendencias(self);
-  // escolhe o próximo processo a executar
-  so_escalona(self);
-  // recupera o estado do processo escolhido
-  return so_despacha(self);
+  if (tem_bloqueado(self)){
+    self->processo_corrente = NULL;
+  }
+  else{
+    console_printf("SO: todos processos foram executados.");
+    self->erro_interno = true;
+  }
 }
 
-static void so_salva_estado_da_cpu(so_t *self)
-{
-  // t1: salva os registradores que compõem o estado da cpu no descritor do
-  //   processo corrente. os valores dos registradores foram colocados pela
-  //   CPU na memória, nos endereços IRQ_END_*
-  // se não houver processo corrente, não faz nada
+// volta todos os processos para o nível 0, para que os que desceram de nível
+//   por usar muita CPU não fiquem sem executar
+static void mlfq_boost(so_t *self){
+  for (int i = 0; i < self->n_slots; i++){
+    processo_t *proc = self->tabela_processos[i];
+    if (proc->estado == MORTO) continue;
+    proc->nivel = 0;
+    fila_prio_altera(self->prontos_prio, proc->slot, chave_pronto(self, proc));
+  }
+  self->ultimo_boost = self->relogio;
 }
 
-static void so_trata_pendencias(so_t *self)
-{
-  // t1: realiza ações que não são diretamente ligadas com a interrupção que
-  //   está sendo atendida:
-  // - E/S pendente
-  // - desbloqueio de processos
-  // - contabilidades
+// escalonador de múltiplas filas com realimentação: executa o primeiro pronto
+//   do nível mais prioritário, com o quantum do nível. quem esgota o quantum
+//   desce um nível; quem bloqueia antes continua no mesmo nível. o processo
+//   corrente perde a CPU se um de nível mais prioritário ficar pronto.
+static void so_escalona_mlfq(so_t *self){
+  if (self->relogio - self->ultimo_boost >= MLFQ_PERIODO_BOOST){
+    mlfq_boost(self);
+  }
+
+  processo_t *corrente = self->processo_corrente;
+  if (corrente != NULL && corrente->estado == PRONTO){
+    // o corrente continua na fila de prontos enquanto executa
+    processo_t *primeiro = primeiro_pronto(self);
+    if (self->quantum > 0 && primeiro->nivel >= corrente->nivel){
+      return;
+    }
+    corrente->metricas.preempcoes++;
+    if (self->quantum == 0 && corrente->nivel < MLFQ_NIVEIS - 1){
+      corrente->nivel++;
+    }
+    ajusta_fila_pronto(self, corrente);
+  }
+
+  if (tam_fila(self) != 0) {
+    self->processo_corrente = primeiro_pronto(self);
+    self->quantum = mlfq_quantum[self->processo_corrente->nivel];
+    return;
+  }
+
+  if (tem_bloqueado(self)){
+    self->processo_corrente = NULL;
+  }
+  else{
+    console_printf("SO: todos processos foram executados.");
+    self->erro_interno = true;
+  }
 }
 
-static void so_escalona(so_t *self)
+// se o processo em execução mudou, a CPU fica ocupada pelo custo da troca
+//   antes de retornar da interrupção; esse tempo é contado nas métricas do
+//   SO e, como qualquer outro, no estado dos processos e no tempo ocioso
+//   (se não tiver processo para executar)
+static void so_troca_contexto(so_t *self, processo_t *anterior)
 {
-  // escolhe o próximo processo a executar, que passa a ser o processo
-  //   corrente; pode continuar sendo o mesmo de antes ou não
-  // t1: na primeira versão, escolhe um processo caso o processo corrente não possa continuar
-  //   executando. depois, implementar escalonador melhor
+  if (self->processo_corrente == anterior) return;
+  self->metricas.n_trocas++;
+  if (self->config.custo_troca == 0) return;
+  cpu_ocupa(self->cpu, self->config.custo_troca);
+  self->metricas.t_troca_contexto += self->config.custo_troca;
 }
 
 static int so_despacha(so_t *self)
 {
-  // t1: se houver processo corrente, coloca o estado desse processo onde ele
-  //   será recuperado pela CPU (em IRQ_END_*) e retorna 0, senão retorna 1
-  // o valor retornado será o valor de retorno de CHAMAC
-  // passa o processador para modo usuário
-  mem_escreve(self->mem, IRQ_END_erro, ERR_OK);
   if (self->erro_interno) return 1;
-  else return 0;
+
+  processo_t *proc = self->processo_corrente;
+
+  if (proc == NULL) {
+    mmu_define_tabpag(self->mmu, NULL);
+    return 1;
+  }
+
+  mem_escreve(self->mem, IRQ_END_PC, proc->reg_pc);
+  mem_escreve(self->mem, IRQ_END_A, proc->reg_a);
+  mem_escreve(self->mem, IRQ_END_X, proc->reg_x);
+  mem_escreve(self->mem, IRQ_END_erro, ERR_OK);
+  mem_escreve(self->mem, IRQ_END_complemento, proc->reg_complemento);
+
+  // a MMU passa a traduzir os endereços virtuais do processo
+  mmu_define_tabpag(self->mmu, proc->tabpag);
+
+  return 0;
 }
 
 // TRATAMENTO DE UMA IRQ {{{1
@@ -215,8 +1506,13 @@ static void so_trata_irq_reset(so_t *self);
 static void so_trata_irq_chamada_sistema(so_t *self);
 static void so_trata_irq_err_cpu(so_t *self);
 static void so_trata_irq_relogio(so_t *self);
+static void so_trata_irq_teclado(so_t *self);
+static void so_trata_irq_tela(so_t *self);
+static void so_trata_irq_disco(so_t *self);
 static void so_trata_irq_desconhecida(so_t *self, int irq);
 
+static bool so_trata_falta_de_pagina(so_t *self, processo_t *proc, int end_virt);
+
 static void so_trata_irq(so_t *self, int irq)
 {
   // verifica o tipo de interrupção que está acontecendo, e atende de acordo
@@ -233,6 +1529,15 @@ static void so_trata_irq(so_t *self, int irq)
     case IRQ_RELOGIO:
       so_trata_irq_relogio(self);
       break;
+    case IRQ_TECLADO:
+      so_trata_irq_teclado(self);
+      break;
+    case IRQ_TELA:
+      so_trata_irq_tela(self);
+      break;
+    case IRQ_DISCO:
+      so_trata_irq_disco(self);
+      break;
     default:
       so_trata_irq_desconhecida(self, irq);
   }
@@ -241,25 +1546,16 @@ static void so_trata_irq(so_t *self, int irq)
 // interrupção gerada uma única vez, quando a CPU inicializa
 static void so_trata_irq_reset(so_t *self)
 {
-  // t1: deveria criar um processo para o init, e inicializar o estado do
-  //   processador para esse processo com os registradores zerados, exceto
-  //   o PC e o modo.
-  // como não tem suporte a processos, está carregando os valores dos
-  //   registradores diretamente para a memória, de onde a CPU vai carregar
-  //   para os seus registradores quando executar a instrução RETI
-
-  // coloca o programa "init" na memória
-  // t2: deveria criar um processo, e programar a tabela de páginas dele
-  processo_t processo = 1; // deveria inicializar um processo...
-  int ender = so_carrega_programa(self, processo, "init.maq");
-  if (ender != 0) {
-    console_printf("SO: problema na carga do programa inicial");
+  // cria o processo inicial (normalmente o init), com o programa carregado
+  //   em sua memória virtual
+  processo_t *init = so_adiciona_processo(self, self->config.programa_inicial);
+
+  if (init == NULL || init->reg_pc != 0) {
+    console_log(MSG_ERRO, "SO: problema na carga do programa inicial");
     self->erro_interno = true;
     return;
   }
 
-  // altera o PC para o endereço de carga (deve ter sido o endereço virtual 0)
-  mem_escreve(self->mem, IRQ_END_PC, ender);
   // passa o processador para modo usuário
   mem_escreve(self->mem, IRQ_END_modo, usuario);
 }
@@ -267,18 +1563,26 @@ static void so_trata_irq_reset(so_t *self)
 // interrupção gerada quando a CPU identifica um erro
 static void so_trata_irq_err_cpu(so_t *self)
 {
-  // Ocorreu um erro interno na CPU
-  // O erro está codificado em IRQ_END_erro
-  // Em geral, causa a morte do processo que causou o erro
-  // Ainda não temos processos, causa a parada da CPU
-  int err_int;
-  // t1: com suporte a processos, deveria pegar o valor do registrador erro
-  //   no descritor do processo corrente, e reagir de acordo com esse erro
-  //   (em geral, matando o processo)
-  mem_le(self->mem, IRQ_END_erro, &err_int);
-  err_t err = err_int;
-  console_printf("SO: IRQ não tratada -- erro na CPU: %s", err_nome(err));
-  self->erro_interno = true;
+  processo_t *proc = self->processo_corrente;
+
+  if (proc == NULL) {
+    console_log(MSG_ERRO, "SO: erro na CPU sem processo em execução");
+    self->erro_interno = true;
+    return;
+  }
+
+  // o erro e o endereço que o causou foram salvos no descritor do processo
+  err_t err = proc->reg_erro;
+  if (err == ERR_PAG_AUSENTE
+      && so_trata_falta_de_pagina(self, proc, proc->reg_complemento)) {
+    // o processo espera a página chegar do disco, e volta a executar a
+    //   mesma instrução
+    return;
+  }
+
+  console_log(MSG_ERRO, "SO: processo %d morto por erro na CPU: %s (%d)",
+                        proc->process_id, err_nome(err), proc->reg_complemento);
+  mata_processo(self, proc->process_id);
 }
 
 // interrupção gerada quando o timer expira
@@ -287,21 +1591,56 @@ static void so_trata_irq_relogio(so_t *self)
   // rearma o interruptor do relógio e reinicializa o timer para a próxima interrupção
   err_t e1, e2;
   e1 = es_escreve(self->es, D_RELOGIO_INTERRUPCAO, 0); // desliga o sinalizador de interrupção
-  e2 = es_escreve(self->es, D_RELOGIO_TIMER, INTERVALO_INTERRUPCAO);
+  e2 = es_escreve(self->es, D_RELOGIO_TIMER, self->config.intervalo_interrupcao);
   if (e1 != ERR_OK || e2 != ERR_OK) {
-    console_printf("SO: problema da reinicialização do timer");
+    console_log(MSG_ERRO, "SO: problema da reinicialização do timer");
     self->erro_interno = true;
   }
-  // t1: deveria tratar a interrupção
-  //   por exemplo, decrementa o quantum do processo corrente, quando se tem
-  //   um escalonador com quantum
-  console_printf("SO: interrupção do relógio (não tratada)");
+
+  if (self->quantum > 0){
+    self->quantum--;
+  }
+  console_log(MSG_DETALHE, "SO: quantum do processo: %d", self->quantum);
+
+  if (substituicoes[self->config.substituicao].tictac != NULL) {
+    substituicoes[self->config.substituicao].tictac(self);
+  }
+}
+
+// interrupção gerada quando algum teclado com a interrupção habilitada tem
+//   caractere para ser lido
+static void so_trata_irq_teclado(so_t *self)
+{
+  for (int terminal = TERMINAL_A; terminal <= TERMINAL_D; terminal += 4) {
+    int pedindo;
+    if (es_le(self->es, TECLADO_INT(terminal), &pedindo) != ERR_OK) {
+      console_log(MSG_ERRO, "SO: problema no acesso à interrupção do teclado");
+      self->erro_interno = true;
+      return;
+    }
+    if (pedindo != 0) so_atende_terminal(self, terminal, LEITURA);
+  }
+}
+
+// interrupção gerada quando alguma tela com a interrupção habilitada pode
+//   receber um caractere
+static void so_trata_irq_tela(so_t *self)
+{
+  for (int terminal = TERMINAL_A; terminal <= TERMINAL_D; terminal += 4) {
+    int pedindo;
+    if (es_le(self->es, TELA_INT(terminal), &pedindo) != ERR_OK) {
+      console_log(MSG_ERRO, "SO: problema no acesso à interrupção da tela");
+      self->erro_interno = true;
+      return;
+    }
+    if (pedindo != 0) so_atende_terminal(self, terminal, ESCRITA);
+  }
 }
 
 // foi gerada uma interrupção para a qual o SO não está preparado
 static void so_trata_irq_desconhecida(so_t *self, int irq)
 {
-  console_printf("SO: não sei tratar IRQ %d (%s)", irq, irq_nome(irq));
+  console_log(MSG_ERRO, "SO: não sei tratar IRQ %d (%s)", irq, irq_nome(irq));
   self->erro_interno = true;
 }
 
@@ -316,15 +1655,16 @@ static void so_chamada_espera_proc(so_t *self);
 
 static void so_trata_irq_chamada_sistema(so_t *self)
 {
-  // a identificação da chamada está no registrador A
-  // t1: com processos, o reg A tá no descritor do processo corrente
-  int id_chamada;
-  if (mem_le(self->mem, IRQ_END_A, &id_chamada) != ERR_OK) {
-    console_printf("SO: erro no acesso ao id da chamada de sistema");
+  processo_t *proc = self->processo_corrente;
+
+  if (proc == NULL) {
+    console_log(MSG_ERRO, "SO: chamada de sistema sem processo em execução");
     self->erro_interno = true;
     return;
   }
-  console_printf("SO: chamada de sistema %d", id_chamada);
+
+  int id_chamada = proc->reg_a;
+  console_log(MSG_DETALHE, "SO: chamada de sistema %d", id_chamada);
   switch (id_chamada) {
     case SO_LE:
       so_chamada_le(self);
@@ -342,136 +1682,560 @@ static void so_trata_irq_chamada_sistema(so_t *self)
       so_chamada_espera_proc(self);
       break;
     default:
-      console_printf("SO: chamada de sistema desconhecida (%d)", id_chamada);
-      // t1: deveria matar o processo
-      self->erro_interno = true;
+      console_log(MSG_ERRO, "SO: chamada de sistema desconhecida (%d), processo %d morto",
+                            id_chamada, proc->process_id);
+      mata_processo(self, proc->process_id);
   }
 }
 
 // implementação da chamada se sistema SO_LE
-// faz a leitura de um dado da entrada corrente do processo, coloca o dado no reg A
 static void so_chamada_le(so_t *self)
 {
-  // implementação com espera ocupada
-  //   T1: deveria realizar a leitura somente se a entrada estiver disponível,
-  //     senão, deveria bloquear o processo.
-  //   no caso de bloqueio do processo, a leitura (e desbloqueio) deverá
-  //     ser feita mais tarde, em tratamentos pendentes em outra interrupção,
-  //     ou diretamente em uma interrupção específica do dispositivo, se for
-  //     o caso
-  // implementação lendo direto do terminal A
-  //   T1: deveria usar dispositivo de entrada corrente do processo
-  for (;;) {
-    int estado;
-    if (es_le(self->es, D_TERM_A_TECLADO_OK, &estado) != ERR_OK) {
-      console_printf("SO: problema no acesso ao estado do teclado");
-      self->erro_interno = true;
-      return;
-    }
-    if (estado != 0) break;
-    // como não está saindo do SO, a unidade de controle não está executando seu laço.
-    // esta gambiarra faz pelo menos a console ser atualizada
-    // T1: com a implementação de bloqueio de processo, esta gambiarra não
-    //   deve mais existir.
-    console_tictac(self->console);
+  int terminal = self->processo_corrente->terminal;
+  fila_espera_t *fila = fila_do_terminal(self, terminal, LEITURA);
+
+  int estado;
+  if (es_le(self->es, terminal_processo(terminal, TECLADO_OK), &estado) != ERR_OK) {
+    console_log(MSG_ERRO, "SO: problema no acesso ao estado do teclado");
+    self->erro_interno = true;
+    return;
   }
+  // se já tem pedido esperando, este vai para o fim da fila
+  if (estado == 0 || fila->ini != NULL){
+    console_log(MSG_DETALHE, "SO: teclado não disponível");
+    muda_estado_processo(self, self->processo_corrente, BLOQUEADO, LEITURA);
+    entra_na_espera(self->processo_corrente, fila);
+    calcula_prioridade(self, self->processo_corrente);
+    remove_fila(self, self->processo_corrente->process_id);
+    // o processo é desbloqueado na interrupção do terminal
+    so_liga_int_terminal(self, TECLADO_INT(terminal), true);
+    return;
+  }
+
   int dado;
-  if (es_le(self->es, D_TERM_A_TECLADO, &dado) != ERR_OK) {
-    console_printf("SO: problema no acesso ao teclado");
+  if (es_le(self->es, terminal_processo(terminal, TECLADO), &dado) != ERR_OK) {
+    console_log(MSG_ERRO, "SO: problema no acesso ao teclado");
     self->erro_interno = true;
     return;
   }
-  // escreve no reg A do processador
-  // (na verdade, na posição onde o processador vai pegar o A quando retornar da int)
-  // T1: se houvesse processo, deveria escrever no reg A do processo
-  // T1: o acesso só deve ser feito nesse momento se for possível; se não, o processo
-  //   é bloqueado, e o acesso só deve ser feito mais tarde (e o processo desbloqueado)
-  mem_escreve(self->mem, IRQ_END_A, dado);
+
+  self->processo_corrente->reg_a = dado;
 }
 
 // implementação da chamada se sistema SO_ESCR
-// escreve o valor do reg X na saída corrente do processo
 static void so_chamada_escr(so_t *self)
 {
-  // implementação com espera ocupada
-  //   T1: deveria bloquear o processo se dispositivo ocupado
-  // implementação escrevendo direto do terminal A
-  //   T1: deveria usar o dispositivo de saída corrente do processo
-  for (;;) {
-    int estado;
-    if (es_le(self->es, D_TERM_A_TELA_OK, &estado) != ERR_OK) {
-      console_printf("SO: problema no acesso ao estado da tela");
-      self->erro_interno = true;
-      return;
-    }
-    if (estado != 0) break;
-    // como não está saindo do SO, a unidade de controle não está executando seu laço.
-    // esta gambiarra faz pelo menos a console ser atualizada
-    // T1: não deve mais existir quando houver suporte a processos, porque o SO não poderá
-    //   executar por muito tempo, permitindo a execução do laço da unidade de controle
-    console_tictac(self->console);
+  int terminal = self->processo_corrente->terminal;
+  fila_espera_t *fila = fila_do_terminal(self, terminal, ESCRITA);
+
+  int estado;
+  if (es_le(self->es, terminal_processo(terminal, TELA_OK), &estado) != ERR_OK) {
+    console_log(MSG_ERRO, "SO: problema no acesso ao estado da tela");
+    self->erro_interno = true;
+    return;
   }
-  int dado;
-  // está lendo o valor de X e escrevendo o de A direto onde o processador colocou/vai pegar
-  // T1: deveria usar os registradores do processo que está realizando a E/S
-  // T1: caso o processo tenha sido bloqueado, esse acesso deve ser realizado em outra execução
-  //   do SO, quando ele verificar que esse acesso já pode ser feito.
-  mem_le(self->mem, IRQ_END_X, &dado);
-  if (es_escreve(self->es, D_TERM_A_TELA, dado) != ERR_OK) {
-    console_printf("SO: problema no acesso à tela");
+  // se já tem pedido esperando, este vai para o fim da fila
+  if (estado == 0 || fila->ini != NULL){
+    console_log(MSG_DETALHE, "SO: tela não disponível");
+    muda_estado_processo(self, self->processo_corrente, BLOQUEADO, ESCRITA);
+    self->processo_corrente->dado_escrita = self->processo_corrente->reg_x;
+    entra_na_espera(self->processo_corrente, fila);
+    calcula_prioridade(self, self->processo_corrente);
+    remove_fila(self, self->processo_corrente->process_id);
+    // o processo é desbloqueado na interrupção do terminal
+    so_liga_int_terminal(self, TELA_INT(terminal), true);
+    return;
+  }
+
+  int dado = self->processo_corrente->reg_x;
+  if (es_escreve(self->es, terminal_processo(terminal, TELA), dado) != ERR_OK) {
+    console_log(MSG_ERRO, "SO: problema no acesso à tela");
     self->erro_interno = true;
     return;
   }
-  mem_escreve(self->mem, IRQ_END_A, 0);
+
+  self->processo_corrente->reg_a = 0;
 }
 
 // implementação da chamada se sistema SO_CRIA_PROC
-// cria um processo
 static void so_chamada_cria_proc(so_t *self)
 {
-  // ainda sem suporte a processos, carrega programa e passa a executar ele
-  // quem chamou o sistema não vai mais ser executado, coitado!
-  // T1: deveria criar um novo processo
-  processo_t processo = 1; // T2: o processo criado
+  processo_t *proc = self->processo_corrente;
 
-  // em X está o endereço onde está o nome do arquivo
-  int ender_proc;
-  // t1: deveria ler o X do descritor do processo criador
-  if (mem_le(self->mem, IRQ_END_X, &ender_proc) == ERR_OK) {
-    char nome[100];
-    if (so_copia_str_do_processo(self, 100, nome, ender_proc, processo)) {
-      int ender_carga = so_carrega_programa(self, processo, nome);
-      // o endereço de carga é endereço virtual, deve ser 0
-      if (ender_carga == 0) {
-        // deveria escrever no PC do descritor do processo criado
-        mem_escreve(self->mem, IRQ_END_PC, ender_carga);
-        return;
-      } // else?
+  if (proc == NULL) return;
+
+  // em X está o endereço (virtual, do processo criador) do nome do programa
+  int ender_proc = proc->reg_x;
+  char nome[100];
+
+  if (so_copia_str_do_processo(self, 100, nome, ender_proc, proc)) {
+    console_printf("SO: criando processo com programa '%s'", nome);
+
+    processo_t *novo = so_adiciona_processo(self, nome);
+
+    if (novo != NULL) {
+      proc->reg_a = novo->process_id;
+      return;
     }
   }
-  // deveria escrever -1 (se erro) ou o PID do processo criado (se OK) no reg A
-  //   do processo que pediu a criação
-  mem_escreve(self->mem, IRQ_END_A, -1);
+  proc->reg_a = -1;
 }
 
 // implementação da chamada se sistema SO_MATA_PROC
-// mata o processo com pid X (ou o processo corrente se X é 0)
 static void so_chamada_mata_proc(so_t *self)
 {
-  // T1: deveria matar um processo
-  // ainda sem suporte a processos, retorna erro -1
-  console_printf("SO: SO_MATA_PROC não implementada");
-  mem_escreve(self->mem, IRQ_END_A, -1);
+  processo_t *proc = self->processo_corrente;
+
+  if (proc == NULL) return;
+
+  int pid_matar = proc->reg_x;
+
+  processo_t *aux = busca_processo(self, pid_matar);
+
+  console_printf("SO: processo %d vai matar processo %d", proc->process_id, pid_matar);
+
+  if (pid_matar == 0){
+    mata_processo(self, proc->process_id);
+    proc->reg_a = 0;
+  }
+  else if (aux != NULL){
+    mata_processo(self, pid_matar);
+    proc->reg_a = 0;
+  }
+  else{
+    proc->reg_a = -1;
+  }
 }
 
 // implementação da chamada se sistema SO_ESPERA_PROC
-// espera o fim do processo com pid X
 static void so_chamada_espera_proc(so_t *self)
 {
-  // T1: deveria bloquear o processo se for o caso (e desbloquear na morte do esperado)
-  // ainda sem suporte a processos, retorna erro -1
-  console_printf("SO: SO_ESPERA_PROC não implementada");
-  mem_escreve(self->mem, IRQ_END_A, -1);
+  processo_t *proc = self->processo_corrente;
+  int id_alvo = proc->reg_x;
+
+  processo_t *alvo = busca_processo(self, id_alvo);
+  bool morto = processo_morto(self, id_alvo);
+
+  if ((alvo == NULL && !morto) || alvo == proc){
+    proc->reg_a = -1;
+    return;
+  }
+
+  if (!morto){
+    muda_estado_processo(self, proc, BLOQUEADO, ESPERANDO_MORRER);
+    entra_na_espera(proc, &alvo->esperas);
+    calcula_prioridade(self, proc);
+    remove_fila(self, proc->process_id);
+    return;
+  }
+
+  muda_estado_processo(self, proc, PRONTO, OK);
+  proc->reg_a = 0;
+}
+
+// MEMÓRIA VIRTUAL {{{1
+
+// Cada processo tem todas as suas páginas no disco, colocadas lá na carga do
+//   programa. As páginas vão para a memória principal por demanda, no
+//   atendimento das faltas de página. Quando não tem quadro livre, o
+//   algoritmo de substituição configurado escolhe o quadro a liberar, e a
+//   página que está nele é copiada de volta para o disco se tiver sido
+//   alterada.
+// As transferências com o disco levam tempo. O processo que causou a falta
+//   fica bloqueado até a sua página chegar, enquanto outros executam. Os
+//   pedidos ao disco são atendidos em ordem, um por vez; o fim de cada um é
+//   avisado por uma interrupção. Um quadro envolvido em uma transferência
+//   não pode ser escolhido pela substituição.
+
+// coloca um pedido de transferência no fim da fila do disco
+static void so_pede_disco(so_t *self, pedido_tipo_t tipo, processo_t *processo,
+                          int pagina, int quadro);
+
+// chamada quando a substituição não encontra quadro para a falta de 'proc';
+//   retorna true se algum quadro vai poder ser escolhido mais tarde, quando
+//   terminar a transferência dele com o disco ou quando o processo dono
+//   (outro que não 'proc') executar a instrução que causou a falta dele
+static bool so_algum_quadro_vai_liberar(so_t *self, processo_t *proc)
+{
+  for (int quadro = self->quadro_ini; quadro < self->n_quadros; quadro++) {
+    quadro_t *q = &self->quadros[quadro];
+    if (q->em_transferencia || q->processo != proc) return true;
+  }
+  return false;
+}
+
+// retorna um quadro livre da memória principal, ou -1 se não tiver
+static int so_acha_quadro_livre(so_t *self)
+{
+  for (int quadro = self->quadro_ini; quadro < self->n_quadros; quadro++) {
+    if (self->quadros[quadro].processo == NULL) return quadro;
+  }
+  return -1;
+}
+
+// pede ao disco para salvar a página que está no quadro; ela continua no
+//   quadro, e deixa de estar alterada quando a transferência terminar
+static void so_salva_quadro(so_t *self, int quadro)
+{
+  quadro_t *q = &self->quadros[quadro];
+  q->em_transferencia = true;
+  so_pede_disco(self, SALVAMENTO, q->processo, q->pagina, quadro);
+  q->processo->metricas.paginas_salvas++;
+}
+
+// tira a página que está no quadro da memória principal, pedindo para
+//   salvá-la no disco se tiver sido alterada; o quadro fica livre
+static void so_descarrega_quadro(so_t *self, int quadro)
+{
+  processo_t *proc = self->quadros[quadro].processo;
+  int pagina = self->quadros[quadro].pagina;
+  if (tabpag_bit_alteracao(proc->tabpag, pagina)) {
+    so_pede_disco(self, DESCARGA, proc, pagina, quadro);
+    proc->metricas.paginas_salvas++;
+  }
+  tabpag_invalida_pagina(proc->tabpag, pagina);
+  self->quadros[quadro].processo = NULL;
+  proc->metricas.paginas_retiradas++;
+}
+
+// escolhe um quadro com o algoritmo de substituição, e libera ele
+// retorna -1 se nenhum quadro puder ser escolhido
+static int so_libera_quadro(so_t *self)
+{
+  int vitima = substituicoes[self->config.substituicao].escolhe_quadro(self);
+  if (vitima < 0) return -1;
+  console_log(MSG_DETALHE, "SO: página %d do processo %d sai do quadro %d",
+                           self->quadros[vitima].pagina,
+                           self->quadros[vitima].processo->process_id, vitima);
+  so_descarrega_quadro(self, vitima);
+  return vitima;
+}
+
+// atende a falta de página causada pelo acesso do processo ao endereço
+//   virtual end_virt, pedindo a página ao disco e bloqueando o processo
+// retorna false se o endereço não pertence ao processo
+static bool so_trata_falta_de_pagina(so_t *self, processo_t *proc, int end_virt)
+{
+  if (end_virt < 0) return false;
+  int pagina = PAGINA_DO_END(end_virt);
+  if (pagina >= proc->n_paginas) return false;
+
+  // as páginas da instrução do processo não podem dar lugar à que falta
+  if (proc->pagina_em_falta < 0) proc->n_falta = self->n_faltas++;
+  proc->pagina_em_falta = pagina;
+  proc->pc_em_falta = proc->reg_pc;
+  proc->falta_adiada = false;
+
+  int quadro = so_acha_quadro_livre(self);
+  if (quadro < 0) {
+    if (self->quadro_ini >= self->n_quadros) {
+      console_log(MSG_ERRO, "SO: não há quadros para os processos");
+      self->erro_interno = true;
+      return true;
+    }
+    self->proc_em_falta = proc;
+    quadro = so_libera_quadro(self);
+    self->proc_em_falta = NULL;
+  }
+  if (quadro < 0 && !so_algum_quadro_vai_liberar(self, proc)) {
+    // nenhum quadro vai ficar livre: a memória não tem quadros para todas as
+    //   páginas da instrução
+    console_log(MSG_ERRO, "SO: memória insuficiente para a falta de página %d"
+                          " do processo %d", pagina, proc->process_id);
+    self->erro_interno = true;
+    return true;
+  }
+  if (quadro < 0) {
+    // o processo vai causar a mesma falta quando executar de novo, e até lá
+    //   alguma transferência com o disco pode ter terminado, ou algum
+    //   processo pode ter executado a instrução da falta dele
+    proc->falta_adiada = true;
+    console_log(MSG_DETALHE, "SO: nenhum quadro disponível, falta de página %d"
+                             " do processo %d adiada", pagina, proc->process_id);
+    return true;
+  }
+
+  quadro_t *q = &self->quadros[quadro];
+  q->processo = proc;
+  q->pagina = pagina;
+  q->n_carga = self->n_cargas++;
+  q->em_transferencia = true;
+  so_pede_disco(self, CARGA, proc, pagina, quadro);
+
+  muda_estado_processo(self, proc, BLOQUEADO, PAGINACAO);
+  calcula_prioridade(self, proc);
+  remove_fila(self, proc->process_id);
+
+  proc->metricas.faltas_de_pagina++;
+  console_log(MSG_DETALHE, "SO: falta de página %d do processo %d, vai para o quadro %d",
+                           pagina, proc->process_id, quadro);
+  return true;
+}
+
+// a página pedida ao disco chegou no quadro
+static void so_conclui_carga(so_t *self, pedido_disco_t *pedido)
+{
+  quadro_t *q = &self->quadros[pedido->quadro];
+  processo_t *proc = pedido->processo;
+  q->em_transferencia = false;
+  if (proc->estado == MORTO) {
+    q->processo = NULL;
+    return;
+  }
+  tabpag_define_quadro(proc->tabpag, pedido->pagina, pedido->quadro);
+  // a página vai ser usada assim que o processo executar; é marcada como
+  //   acessada para não ser escolhida pela substituição antes disso
+  tabpag_marca_bit_acesso(proc->tabpag, pedido->pagina, false);
+  q->idade = 1u << (BITS_IDADE - 1);
+  q->t_uso = self->relogio;
+
+  muda_estado_processo(self, proc, PRONTO, OK);
+  ajusta_fila(self, proc);
+  console_log(MSG_DETALHE, "SO: desbloqueado processo %d - página %d no quadro %d",
+                           proc->process_id, pedido->pagina, pedido->quadro);
+}
+
+// a página do quadro foi salva no disco, e continua no quadro
+static void so_conclui_salvamento(so_t *self, pedido_disco_t *pedido)
+{
+  quadro_t *q = &self->quadros[pedido->quadro];
+  processo_t *proc = pedido->processo;
+  q->em_transferencia = false;
+  if (proc->estado == MORTO) {
+    q->processo = NULL;
+    return;
+  }
+  // redefinir o quadro zera os bits de acesso e alteração
+  bool acessada = tabpag_bit_acesso(proc->tabpag, pedido->pagina);
+  tabpag_define_quadro(proc->tabpag, pedido->pagina, pedido->quadro);
+  if (acessada) tabpag_marca_bit_acesso(proc->tabpag, pedido->pagina, false);
+}
+
+static void so_libera_memoria_processo(so_t *self, processo_t *proc)
+{
+  // quadros em transferência são liberados quando ela terminar
+  for (int quadro = self->quadro_ini; quadro < self->n_quadros; quadro++) {
+    quadro_t *q = &self->quadros[quadro];
+    if (q->processo == proc && !q->em_transferencia) {
+      q->processo = NULL;
+    }
+  }
+  // a MMU não pode continuar com a tabela de um processo que não existe
+  if (proc == self->processo_corrente) mmu_define_tabpag(self->mmu, NULL);
+  tabpag_destroi(proc->tabpag);
+  proc->tabpag = NULL;
+}
+
+// DISCO {{{1
+
+// bloco do disco onde está a página do processo
+static int so_bloco_da_pagina(processo_t *processo, int pagina)
+{
+  return processo->bloco_disco + pagina;
+}
+
+// programa o disco para realizar o pedido que está no início da fila
+static void so_inicia_disco(so_t *self)
+{
+  pedido_disco_t *pedido = &self->pedidos[self->ini_pedidos];
+  int comando = (pedido->tipo == CARGA) ? DISCO_LE : DISCO_ESCREVE;
+  err_t e1, e2, e3;
+  e1 = es_escreve(self->es, D_DISCO_BLOCO,
+                  so_bloco_da_pagina(pedido->processo, pedido->pagina));
+  e2 = es_escreve(self->es, D_DISCO_ENDERECO, pedido->quadro * TAM_PAGINA);
+  e3 = es_escreve(self->es, D_DISCO_COMANDO, comando);
+  if (e1 != ERR_OK || e2 != ERR_OK || e3 != ERR_OK) {
+    console_log(MSG_ERRO, "SO: problema na programação do disco");
+    self->erro_interno = true;
+  }
+}
+
+static void so_pede_disco(so_t *self, pedido_tipo_t tipo, processo_t *processo,
+                          int pagina, int quadro)
+{
+  // cada quadro tem no máximo dois pedidos (descarga e carga) na fila
+  assert(self->n_pedidos < self->tam_pedidos);
+  int fim = (self->ini_pedidos + self->n_pedidos) % self->tam_pedidos;
+  self->pedidos[fim] = (pedido_disco_t){ tipo, processo, pagina, quadro };
+  self->n_pedidos++;
+  processo->n_pedidos_disco++;
+  // se o disco estava livre, já começa
+  if (self->n_pedidos == 1) so_inicia_disco(self);
+}
+
+// interrupção gerada quando o disco termina uma transferência
+static void so_trata_irq_disco(so_t *self)
+{
+  if (es_escreve(self->es, D_DISCO_INTERRUPCAO, 0) != ERR_OK) {
+    console_log(MSG_ERRO, "SO: problema no acesso ao disco");
+    self->erro_interno = true;
+    return;
+  }
+  if (self->n_pedidos == 0) {
+    console_log(MSG_ERRO, "SO: interrupção do disco sem pedido");
+    return;
+  }
+  pedido_disco_t pedido = self->pedidos[self->ini_pedidos];
+  self->ini_pedidos = (self->ini_pedidos + 1) % self->tam_pedidos;
+  self->n_pedidos--;
+  if (self->n_pedidos > 0) so_inicia_disco(self);
+
+  switch (pedido.tipo) {
+    case CARGA:
+      so_conclui_carga(self, &pedido);
+      break;
+    case SALVAMENTO:
+      so_conclui_salvamento(self, &pedido);
+      break;
+    case DESCARGA:
+      // o quadro já é de outra página, que tem a carga na fila
+      break;
+  }
+  processo_t *proc = pedido.processo;
+  proc->n_pedidos_disco--;
+  if (proc->estado == MORTO && proc->n_pedidos_disco == 0) libera_slot(self, proc);
+}
+
+// se a página do processo está sendo descarregada, retorna o quadro onde ela
+//   ainda está (a carga que vai sobrescrever o quadro está depois na fila);
+//   senão retorna -1
+static int so_quadro_em_descarga(so_t *self, processo_t *processo, int pagina)
+{
+  for (int i = 0; i < self->n_pedidos; i++) {
+    pedido_disco_t *pedido = &self->pedidos[(self->ini_pedidos + i) % self->tam_pedidos];
+    if (pedido->tipo == DESCARGA && pedido->processo == processo
+        && pedido->pagina == pagina) {
+      return pedido->quadro;
+    }
+  }
+  return -1;
+}
+
+// ALGORITMOS DE SUBSTITUIÇÃO {{{1
+
+// todos são chamados somente quando não tem quadro livre, e só escolhem
+//   quadros substituíveis; retornam -1 se não tiver quadro para escolher
+
+// não pode ser escolhido um quadro em transferência, nem um com página da
+//   falta ou da instrução de um processo que ainda não executou a instrução
+//   que causou uma falta de página (ver pagina_em_falta), a não ser que esse
+//   processo esteja adiado e a falta sendo atendida seja mais antiga
+static bool so_quadro_substituivel(so_t *self, quadro_t *q)
+{
+  if (q->em_transferencia) return false;
+  processo_t *proc = q->processo;
+  if (proc->pagina_em_falta < 0) return true;
+  if (q->pagina != proc->pagina_em_falta
+      && q->pagina != PAGINA_DO_END(proc->reg_pc)
+      && q->pagina != PAGINA_DO_END(proc->reg_pc + 1)) {
+    return true;
+  }
+  processo_t *em_falta = self->proc_em_falta;
+  return proc != em_falta && proc->falta_adiada
+         && em_falta->n_falta < proc->n_falta;
+}
+
+// avança o ponteiro dos algoritmos de relógio, que percorre os quadros dos
+//   processos circularmente
+static int so_avanca_ponteiro(so_t *self)
+{
+  int quadro = self->ponteiro;
+  self->ponteiro++;
+  if (self->ponteiro >= self->n_quadros) self->ponteiro = self->quadro_ini;
+  return quadro;
+}
+
+// FIFO: a página carregada há mais tempo
+static int so_substitui_fifo(so_t *self)
+{
+  int vitima = -1;
+  for (int quadro = self->quadro_ini; quadro < self->n_quadros; quadro++) {
+    quadro_t *q = &self->quadros[quadro];
+    if (!so_quadro_substituivel(self, q)) continue;
+    if (vitima < 0 || q->n_carga < self->quadros[vitima].n_carga) {
+      vitima = quadro;
+    }
+  }
+  return vitima;
+}
+
+// segunda chance, na versão com relógio: a primeira página não acessada a
+//   partir do ponteiro; as acessadas que são puladas perdem o bit de acesso
+static int so_substitui_segunda_chance(so_t *self)
+{
+  int n_quadros = self->n_quadros - self->quadro_ini;
+  for (int i = 0; i < 2 * n_quadros; i++) {
+    int quadro = so_avanca_ponteiro(self);
+    quadro_t *q = &self->quadros[quadro];
+    if (!so_quadro_substituivel(self, q)) continue;
+    if (!tabpag_bit_acesso(q->processo->tabpag, q->pagina)) return quadro;
+    tabpag_zera_bit_acesso(q->processo->tabpag, q->pagina);
+  }
+  return -1;
+}
+
+// envelhecimento: a cada interrupção do relógio, a idade de cada página é
+//   deslocada e recebe o bit de acesso no bit mais alto, e o bit é zerado
+static void so_envelhece_quadros(so_t *self)
+{
+  for (int quadro = self->quadro_ini; quadro < self->n_quadros; quadro++) {
+    quadro_t *q = &self->quadros[quadro];
+    if (q->processo == NULL || q->em_transferencia) continue;
+    q->idade >>= 1;
+    if (tabpag_bit_acesso(q->processo->tabpag, q->pagina)) {
+      q->idade |= 1u << (BITS_IDADE - 1);
+      tabpag_zera_bit_acesso(q->processo->tabpag, q->pagina);
+    }
+  }
+}
+
+// LRU aproximado: a página com menor idade (a usada há mais tempo); no
+//   empate, a carregada há mais tempo
+static int so_substitui_lru(so_t *self)
+{
+  int vitima = -1;
+  for (int quadro = self->quadro_ini; quadro < self->n_quadros; quadro++) {
+    quadro_t *q = &self->quadros[quadro];
+    if (!so_quadro_substituivel(self, q)) continue;
+    if (vitima < 0) {
+      vitima = quadro;
+      continue;
+    }
+    quadro_t *v = &self->quadros[vitima];
+    if (q->idade < v->idade || (q->idade == v->idade && q->n_carga < v->n_carga)) {
+      vitima = quadro;
+    }
+  }
+  return vitima;
+}
+
+// WSClock: a partir do ponteiro, a primeira página não alterada que está fora
+//   do conjunto de trabalho (não usada há mais de TAU_WSCLOCK instruções).
+//   Página acessada tem o instante de uso atualizado e perde o bit de acesso;
+//   página fora do conjunto de trabalho mas alterada é mandada salvar, e pode
+//   ser escolhida numa próxima volta do ponteiro.
+// se em duas voltas não encontrar, escolhe a primeira substituível
+static int so_substitui_wsclock(so_t *self)
+{
+  int n_quadros = self->n_quadros - self->quadro_ini;
+  for (int i = 0; i < 2 * n_quadros; i++) {
+    int quadro = so_avanca_ponteiro(self);
+    quadro_t *q = &self->quadros[quadro];
+    if (!so_quadro_substituivel(self, q)) continue;
+    tabpag_t *tabpag = q->processo->tabpag;
+    if (tabpag_bit_acesso(tabpag, q->pagina)) {
+      tabpag_zera_bit_acesso(tabpag, q->pagina);
+      q->t_uso = self->relogio;
+    } else if (self->relogio - q->t_uso > TAU_WSCLOCK) {
+      if (!tabpag_bit_alteracao(tabpag, q->pagina)) return quadro;
+      so_salva_quadro(self, quadro);
+    }
+  }
+  for (int i = 0; i < n_quadros; i++) {
+    int quadro = so_avanca_ponteiro(self);
+    if (so_quadro_substituivel(self, &self->quadros[quadro])) return quadro;
+  }
+  return -1;
 }
 
 // CARGA DE PROGRAMA {{{1
@@ -480,23 +2244,23 @@ static void so_chamada_espera_proc(so_t *self)
 static int so_carrega_programa_na_memoria_fisica(so_t *self, programa_t *programa);
 static int so_carrega_programa_na_memoria_virtual(so_t *self,
                                                   programa_t *programa,
-                                                  processo_t processo);
+                                                  processo_t *processo);
 
-// carrega o programa na memória de um processo ou na memória física se NENHUM_PROCESSO
+// carrega o programa na memória de um processo ou na memória física se NULL
 // retorna o endereço de carga ou -1
-static int so_carrega_programa(so_t *self, processo_t processo,
+static int so_carrega_programa(so_t *self, processo_t *processo,
                                char *nome_do_executavel)
 {
   console_printf("SO: carga de '%s'", nome_do_executavel);
 
   programa_t *programa = prog_cria(nome_do_executavel);
   if (programa == NULL) {
-    console_printf("Erro na leitura do programa '%s'\n", nome_do_executavel);
+    console_log(MSG_ERRO, "Erro na leitura do programa '%s'\n", nome_do_executavel);
     return -1;
   }
 
   int end_carga;
-  if (processo == NENHUM_PROCESSO) {
+  if (processo == NULL) {
     end_carga = so_carrega_programa_na_memoria_fisica(self, programa);
   } else {
     end_carga = so_carrega_programa_na_memoria_virtual(self, programa, processo);
@@ -513,7 +2277,7 @@ static int so_carrega_programa_na_memoria_fisica(so_t *self, programa_t *program
 
   for (int end = end_ini; end < end_fim; end++) {
     if (mem_escreve(self->mem, end, prog_dado(programa, end)) != ERR_OK) {
-      console_printf("Erro na carga da memória, endereco %d\n", end);
+      console_log(MSG_ERRO, "Erro na carga da memória, endereco %d\n", end);
       return -1;
     }
   }
@@ -521,65 +2285,82 @@ static int so_carrega_programa_na_memoria_fisica(so_t *self, programa_t *program
   return end_ini;
 }
 
+// o programa é todo carregado no disco, a partir do primeiro bloco livre, e
+//   nenhuma página é colocada na memória principal
 static int so_carrega_programa_na_memoria_virtual(so_t *self,
                                                   programa_t *programa,
-                                                  processo_t processo)
-{
-  // t2: isto tá furado...
-  // está simplesmente lendo para o próximo quadro que nunca foi ocupado,
-  //   nem testa se tem memória disponível
-  // com memória virtual, a forma mais simples de implementar a carga de um
-  //   programa é carregá-lo para a memória secundária, e mapear todas as páginas
-  //   da tabela de páginas do processo como inválidas. Assim, as páginas serão
-  //   colocadas na memória principal por demanda. Para simplificar ainda mais, a
-  //   memória secundária pode ser alocada da forma como a principal está sendo
-  //   alocada aqui (sem reuso)
+                                                  processo_t *processo)
+{
   int end_virt_ini = prog_end_carga(programa);
   int end_virt_fim = end_virt_ini + prog_tamanho(programa) - 1;
-  int pagina_ini = end_virt_ini / TAM_PAGINA;
-  int pagina_fim = end_virt_fim / TAM_PAGINA;
-  int quadro_ini = self->quadro_livre;
-  // mapeia as páginas nos quadros
-  int quadro = quadro_ini;
-  for (int pagina = pagina_ini; pagina <= pagina_fim; pagina++) {
-    //tabpag_define_quadro(self->tabpag_global, pagina, quadro);
-    quadro++;
-  }
-  self->quadro_livre = quadro;
-
-  // carrega o programa na memória principal
-  int end_fis_ini = quadro_ini * TAM_PAGINA;
-  int end_fis = end_fis_ini;
+  if (end_virt_ini < 0) {
+    console_log(MSG_ERRO, "Erro na carga, endereço inicial %d inválido\n", end_virt_ini);
+    return -1;
+  }
+  // o espaço de endereçamento do processo vai da página 0 até a que contém
+  //   o último endereço do programa
+  int n_paginas = PAGINA_DO_END(end_virt_fim) + 1;
+  int bloco = self->bloco_livre;
+  if (bloco + n_paginas > self->n_blocos) {
+    console_log(MSG_ERRO, "SO: disco cheio, não cabem %d páginas", n_paginas);
+    return -1;
+  }
+
+  int end_disco = bloco * TAM_PAGINA + end_virt_ini;
+  if (es_escreve(self->es, D_DISCO_POSICAO, end_disco) != ERR_OK) {
+    console_log(MSG_ERRO, "Erro na carga no disco, posição %d\n", end_disco);
+    return -1;
+  }
   for (int end_virt = end_virt_ini; end_virt <= end_virt_fim; end_virt++) {
-    if (mem_escreve(self->mem, end_fis, prog_dado(programa, end_virt)) != ERR_OK) {
-      console_printf("Erro na carga da memória, end virt %d fís %d\n", end_virt,
-                     end_fis);
+    if (es_escreve(self->es, D_DISCO_DADO, prog_dado(programa, end_virt)) != ERR_OK) {
+      console_log(MSG_ERRO, "Erro na carga no disco, end virt %d\n", end_virt);
       return -1;
     }
-    end_fis++;
   }
-  console_printf("carregado na memória virtual V%d-%d F%d-%d",
-                 end_virt_ini, end_virt_fim, end_fis_ini, end_fis - 1);
+  processo->bloco_disco = bloco;
+  processo->n_paginas = n_paginas;
+  self->bloco_livre = bloco + n_paginas;
+
+  console_printf("carregado no disco V%d-%d blocos %d-%d",
+                 end_virt_ini, end_virt_fim, bloco, bloco + n_paginas - 1);
   return end_virt_ini;
 }
 
 // ACESSO À MEMÓRIA DOS PROCESSOS {{{1
 
+// lê o valor no endereço virtual end_virt do processo, que pode estar na
+//   memória principal (se a página estiver mapeada ou sendo descarregada)
+//   ou no disco
+// retorna false se o endereço não pertence ao processo
+static bool so_le_mem_processo(so_t *self, processo_t *processo, int end_virt,
+                               int *pvalor)
+{
+  if (end_virt < 0) return false;
+  int pagina = PAGINA_DO_END(end_virt);
+  if (pagina >= processo->n_paginas) return false;
+  int quadro;
+  if (tabpag_traduz(processo->tabpag, pagina, &quadro) == ERR_OK
+      || (quadro = so_quadro_em_descarga(self, processo, pagina)) >= 0) {
+    int end_fis = quadro * TAM_PAGINA + DESLOCAMENTO_DO_END(end_virt);
+    return mem_le(self->mem, end_fis, pvalor) == ERR_OK;
+  }
+  int end_disco = so_bloco_da_pagina(processo, pagina) * TAM_PAGINA
+                  + DESLOCAMENTO_DO_END(end_virt);
+  return es_escreve(self->es, D_DISCO_POSICAO, end_disco) == ERR_OK
+         && es_le(self->es, D_DISCO_DADO, pvalor) == ERR_OK;
+}
+
 // copia uma string da memória do processo para o vetor str.
 // retorna false se erro (string maior que vetor, valor não char na memória,
 //   erro de acesso à memória)
 // O endereço é um endereço virtual de um processo.
-// T2: Com memória virtual, cada valor do espaço de endereçamento do processo
-//   pode estar em memória principal ou secundária (e tem que achar onde)
 static bool so_copia_str_do_processo(so_t *self, int tam, char str[tam],
-                                     int end_virt, processo_t processo)
+                                     int end_virt, processo_t *processo)
 {
-  if (processo == NENHUM_PROCESSO) return false;
+  if (processo == NULL) return false;
   for (int indice_str = 0; indice_str < tam; indice_str++) {
     int caractere;
-    // não tem memória virtual implementada, posso usar a mmu para traduzir
-    //   os endereços e acessar a memória
-    if (mmu_le(self->mmu, end_virt + indice_str, &caractere, usuario) != ERR_OK) {
+    if (!so_le_mem_processo(self, processo, end_virt + indice_str, &caractere)) {
       return false;
     }
     if (caractere < 0 || caractere > 255) {
@@ -14,8 +14,60 @@ typedef struct so_t so_t;
 #include "es.h"
 #include "console.h" // só para uma gambiarra
 
+#include <stdbool.h>
+
+// formatos do arquivo de métricas
+typedef enum {
+  METRICAS_TEXTO,   // texto para leitura humana, só no final da execução
+  METRICAS_CSV,     // uma linha por métrica: instante,processo,metrica,item,valor
+  METRICAS_JSON,    // um objeto JSON por linha, um por amostra
+  N_FORMATOS_METRICAS
+} formato_metricas_t;
+
+// parâmetros do SO, escolhidos na inicialização do simulador (linha de
+//   comando ou arquivo de configuração, ver main.c), sem recompilar
+typedef struct {
+  // escalonador: 0 simples, 1 round-robin, 2 prioridade, 3 múltiplas filas
+  int escalonador;
+  // quantum dos escalonadores round-robin e prioridade, em interrupções do
+  //   relógio
+  int quantum;
+  // intervalo entre interrupções do relógio, em instruções executadas
+  int intervalo_interrupcao;
+  // algoritmo de substituição de páginas: 0 FIFO, 1 segunda chance,
+  //   2 LRU aproximado por envelhecimento, 3 WSClock
+  int substituicao;
+  // arquivo onde as métricas são escritas
+  //   (NULL para ../Metricas/metricas_so_<escalonador>.<txt, csv ou json>)
+  // a string deve existir enquanto o SO existir
+  char *arq_metricas;
+  formato_metricas_t formato_metricas;
+  // nos formatos CSV e JSON, grava uma amostra das métricas a cada tantas
+  //   instruções executadas, além das métricas finais (0 para só as finais)
+  int intervalo_amostras;
+  // custo de cada troca do processo em execução, em instruções (tempo em que
+  //   a CPU fica ocupada com a troca, sem executar instruções)
+  int custo_troca;
+  // latências do disco usado como memória secundária, em instruções
+  //   executadas: de busca, quando o bloco não é o seguinte ao da última
+  //   transferência, e de transferência, por bloco (o disco é do hardware,
+  //   mas é configurado junto com o SO, para as medidas da paginação)
+  int disco_t_busca;
+  int disco_t_transferencia;
+  // programa executado pelo primeiro processo, que cria os outros (a carga
+  //   de trabalho); a string deve existir enquanto o SO existir
+  char *programa_inicial;
+} so_config_t;
+
+// preenche a configuração com os valores padrão
+void so_config_padrao(so_config_t *config);
+
+// retorna true se os parâmetros da configuração têm valores aceitos pelo SO
+bool so_config_valida(so_config_t *config);
+
+// cria o SO com a configuração 'config', que é copiada
 so_t *so_cria(cpu_t *cpu, mem_t *mem, mmu_t *mmu,
-              es_t *es, console_t *console);
+              es_t *es, console_t *console, so_config_t *config);
 void so_destroi(so_t *self);
 
 // Chamadas de sistema
@@ -26,6 +26,9 @@ struct tabpag_t {
   // o último descritor do vetor sempre contém uma página válida
   // pode ser NULL (se tam_tab == 0)
   descritor_t *tabela;
+  // função chamada quando uma página é alterada (e seu argumento)
+  tabpag_f_alteracao_t observador;
+  void *arg_observador;
 };
 
 tabpag_t *tabpag_cria(void)
@@ -34,9 +37,25 @@ tabpag_t *tabpag_cria(void)
   assert(self != NULL);
   self->tam_tab = 0;
   self->tabela = NULL;
+  self->observador = NULL;
   return self;
 }
 
+void tabpag_define_observador(tabpag_t *self, tabpag_f_alteracao_t func,
+                              void *arg)
+{
+  self->observador = func;
+  self->arg_observador = arg;
+}
+
+// avisa o observador que a página foi alterada
+static void tabpag__avisa(tabpag_t *self, int pagina)
+{
+  if (self->observador != NULL) {
+    self->observador(self->arg_observador, pagina);
+  }
+}
+
 void tabpag_destroi(tabpag_t *self)
 {
   if (self != NULL) {
@@ -56,6 +75,7 @@ void tabpag_invalida_pagina(tabpag_t *self, int pagina)
 {
   // página já é inválida -- não faz nada
   if (!tabpag__pagina_valida(self, pagina)) return;
+  tabpag__avisa(self, pagina);
   // página não é a última da tabela -- marca como inválida
   if (pagina < self->tam_tab - 1) {
     self->tabela[pagina].valida = false;
@@ -100,6 +120,7 @@ void tabpag_define_quadro(tabpag_t *self, int pagina, int quadro)
   self->tabela[pagina].valida = true;
   self->tabela[pagina].acessada = false;
   self->tabela[pagina].alterada = false;
+  tabpag__avisa(self, pagina);
 }
 
 void tabpag_marca_bit_acesso(tabpag_t *self, int pagina, bool alteracao)
@@ -115,6 +136,7 @@ void tabpag_zera_bit_acesso(tabpag_t *self, int pagina)
 {
   if (!tabpag__pagina_valida(self, pagina)) return;
   self->tabela[pagina].acessada = false;
+  tabpag__avisa(self, pagina);
 }
 
 bool tabpag_bit_acesso(tabpag_t *self, int pagina)
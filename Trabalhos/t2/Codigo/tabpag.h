@@ -61,4 +61,15 @@ bool tabpag_bit_alteracao(tabpag_t *self, int pagina);
 // retorna ERR_PAG_AUSENTE (e não altera '*pquadro') se a página for inválida
 err_t tabpag_traduz(tabpag_t *self, int pagina, int *pquadro);
 
+// tipo da função chamada quando a informação de uma página é alterada por
+//   tabpag_define_quadro, tabpag_invalida_pagina ou tabpag_zera_bit_acesso
+// recebe o argumento fornecido na definição e o número da página
+typedef void (*tabpag_f_alteracao_t)(void *arg, int pagina);
+
+// define uma função a ser chamada quando a informação de uma página é
+//   alterada (usada pela MMU para manter a TLB coerente com a tabela)
+// NULL para não chamar nada
+void tabpag_define_observador(tabpag_t *self, tabpag_f_alteracao_t func,
+                              void *arg);
+
 #endif // TABPAG_H
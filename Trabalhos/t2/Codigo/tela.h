@@ -23,9 +23,6 @@ void tela_init(void);
 // finaliza o uso da tela
 void tela_fim();
 
-// programa número de milisegundos a esperar a cada leitura do teclado
-void tela_espera(int ms);
-
 // posiciona o cursor
 void tela_posiciona(int lin, int col);
 
@@ -36,8 +33,15 @@ void tela_puts(int cor, char *str);
 void tela_limpa_linha();
 
 // retorna a próxima tecla digitada, ou 0 se não houver
+// o teclado do sistema é verificado no máximo a cada poucos milissegundos;
+//   nas chamadas entre verificações, retorna 0 sem custo (a não ser que a
+//   última verificação tenha encontrado tecla)
 char tela_tecla(void);
 
+// espera até 'ms' milissegundos que seja digitada uma tecla, que poderá ser
+//   lida com tela_tecla
+void tela_espera_tecla(int ms);
+
 // envia para a tela o que foi escrito
 void tela_atualiza();
 
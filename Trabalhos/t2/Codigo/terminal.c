@@ -32,10 +32,26 @@ struct terminal_t {
   enum { normal, rolando, limpando } estado_saida;
   // posicao do caractere que está sendo movido durante uma rolagem
   int pos_rolagem;
+  // arquivo onde é copiada a saída (NULL se não tiver)
+  FILE *arquivo_saida;
+  // se as interrupções do teclado e da tela estão habilitadas
+  bool int_teclado;
+  bool int_tela;
+  // se as interrupções estão sendo pedidas ao controlador (NULL se não tiver)
+  pic_t *pic;
+  irq_t irq_teclado;
+  irq_t irq_tela;
+  bool pede_teclado;
+  bool pede_tela;
+  // agenda do passo da rolagem ou da limpeza, programado enquanto a saída
+  //   não está no estado normal
+  agenda_t *agenda;
+  evento_t passo_saida;
 };
 
+static void terminal_passo_saida(void *arg);
 
-terminal_t *terminal_cria(int tam_linha)
+terminal_t *terminal_cria(int tam_linha, agenda_t *agenda)
 {
   terminal_t *self = malloc(sizeof(*self));
   assert(self != NULL);
@@ -48,12 +64,21 @@ terminal_t *terminal_cria(int tam_linha)
   strcpy(self->entrada, "");
   strcpy(self->saida, "");
   self->estado_saida = normal;
+  self->arquivo_saida = NULL;
+  self->int_teclado = false;
+  self->int_tela = false;
+  self->pic = NULL;
+  self->pede_teclado = false;
+  self->pede_tela = false;
+  self->agenda = agenda;
+  evento_inicializa(&self->passo_saida, terminal_passo_saida, self);
 
   return self;
 }
 
 void terminal_destroi(terminal_t *self)
 {
+  agenda_cancela(self->agenda, &self->passo_saida);
   free(self->entrada);
   free(self->saida);
   free(self);
@@ -64,6 +89,45 @@ static bool terminal_entrada_vazia(terminal_t *self)
   return self->entrada[0] == '\0';
 }
 
+static bool terminal_pode_imprimir(terminal_t *self)
+{
+  return self->estado_saida == normal;
+}
+
+void terminal_define_pic(terminal_t *self, pic_t *pic, irq_t irq_teclado,
+                         irq_t irq_tela)
+{
+  self->pic = pic;
+  self->irq_teclado = irq_teclado;
+  self->irq_tela = irq_tela;
+}
+
+// avisa o controlador de interrupções se o pedido mudou
+static void terminal_muda_pedido(terminal_t *self, bool *ppede, bool pede,
+                                 irq_t irq)
+{
+  if (*ppede == pede) return;
+  *ppede = pede;
+  if (pede) {
+    pic_pede(self->pic, irq);
+  } else {
+    pic_retira(self->pic, irq);
+  }
+}
+
+// recalcula os pedidos de interrupção, depois de uma mudança no estado do
+//   terminal
+static void terminal_atualiza_interrupcoes(terminal_t *self)
+{
+  if (self->pic == NULL) return;
+  terminal_muda_pedido(self, &self->pede_teclado,
+                       self->int_teclado && !terminal_entrada_vazia(self),
+                       self->irq_teclado);
+  terminal_muda_pedido(self, &self->pede_tela,
+                       self->int_tela && terminal_pode_imprimir(self),
+                       self->irq_tela);
+}
+
 static char terminal_le_char(terminal_t *self)
 {
   char *p = self->entrada;
@@ -82,18 +146,28 @@ void terminal_insere_char(terminal_t *self, char ch)
   if (tam >= self->tam_linha-2) return;
   p[tam] = ch;
   p[tam+1] = '\0';
+  terminal_atualiza_interrupcoes(self);
 }
 
-static bool terminal_pode_imprimir(terminal_t *self)
+bool terminal_entrada_cheia(terminal_t *self)
 {
-  return self->estado_saida == normal;
+  return strlen(self->entrada) >= self->tam_linha-2;
+}
+
+void terminal_define_arquivo_saida(terminal_t *self, FILE *arq)
+{
+  self->arquivo_saida = arq;
 }
 
 static void terminal_imprime(terminal_t *self, char ch)
 {
   if (terminal_pode_imprimir(self)) {
+    if (self->arquivo_saida != NULL) {
+      fputc(ch, self->arquivo_saida);
+    }
     if (ch == '\n') {
       self->estado_saida = limpando;
+      agenda_programa(self->agenda, &self->passo_saida, 1);
       return;
     }
     int tam = strlen(self->saida);
@@ -103,6 +177,7 @@ static void terminal_imprime(terminal_t *self, char ch)
     if (tam >= self->tam_linha - 1) {
       self->estado_saida = rolando;
       self->pos_rolagem = 0;
+      agenda_programa(self->agenda, &self->passo_saida, 1);
     }
   }
 }
@@ -111,6 +186,8 @@ void terminal_limpa_saida(terminal_t *self)
 {
   self->saida[0] = '\0';
   self->estado_saida = normal;
+  agenda_cancela(self->agenda, &self->passo_saida);
+  terminal_atualiza_interrupcoes(self);
 }
 
 static void terminal_atualiza_rolagem(terminal_t *self)
@@ -139,18 +216,25 @@ static void terminal_atualiza_limpeza(terminal_t *self)
 }
 
 // altera a string de saída em 1 caractere, se estiver rolando ou limpando
-void terminal_tictac(terminal_t *self)
+// chamada pela agenda, uma vez por unidade de tempo até voltar ao normal
+static void terminal_passo_saida(void *arg)
 {
+  terminal_t *self = arg;
   switch (self->estado_saida) {
     case normal: 
       break;
     case rolando:
       terminal_atualiza_rolagem(self);
+      terminal_atualiza_interrupcoes(self);
       break;
     case limpando:
       terminal_atualiza_limpeza(self);
+      terminal_atualiza_interrupcoes(self);
       break;
   }
+  if (self->estado_saida != normal) {
+    agenda_programa(self->agenda, &self->passo_saida, 1);
+  }
 }
 
 char *terminal_txt_entrada(terminal_t *self)
@@ -164,16 +248,18 @@ char *terminal_txt_saida(terminal_t *self)
 }
 
 // Operações de leitura e escrita no terminal, chamadas pelo controlador de E/S
-// Para o controlador, cada terminal é composto por 4 dispositivos:
-//   leitura, estado da leitura, escrita, estado da escrita
+// Para o controlador, cada terminal é composto por 6 dispositivos:
+//   leitura, estado da leitura, escrita, estado da escrita,
+//   interrupção do teclado, interrupção da tela
 err_t terminal_leitura(void *disp, int id, int *pvalor)
 {
   terminal_t *self = disp;
 
-  switch (id % 4) {
+  switch (id) {
     case 0: // leitura do teclado
       if (terminal_entrada_vazia(self)) return ERR_OCUP;
       *pvalor = terminal_le_char(self);
+      terminal_atualiza_interrupcoes(self);
       break;
     case 1: // estado do teclado
       if (terminal_entrada_vazia(self)) {
@@ -191,6 +277,12 @@ err_t terminal_leitura(void *disp, int id, int *pvalor)
         *pvalor = 0;
       }
       break;
+    case 4: // interrupção do teclado
+      *pvalor = (self->int_teclado && !terminal_entrada_vazia(self)) ? 1 : 0;
+      break;
+    case 5: // interrupção da tela
+      *pvalor = (self->int_tela && terminal_pode_imprimir(self)) ? 1 : 0;
+      break;
     default:
       return ERR_DISP_INV;
   }
@@ -200,7 +292,7 @@ err_t terminal_leitura(void *disp, int id, int *pvalor)
 err_t terminal_escrita(void *disp, int id, int valor)
 {
   terminal_t *self = disp;
-  switch (id % 4) {
+  switch (id) {
     case 0: // leitura do teclado
       return ERR_OP_INV;
     case 1: // estado do teclado
@@ -208,9 +300,18 @@ err_t terminal_escrita(void *disp, int id, int valor)
     case 2: // escrita na tela
       if (!terminal_pode_imprimir(self)) return ERR_OCUP;
       terminal_imprime(self, valor);
+      terminal_atualiza_interrupcoes(self);
       break;
     case 3: // estado da tela
       return ERR_OP_INV;
+    case 4: // interrupção do teclado
+      self->int_teclado = (valor != 0);
+      terminal_atualiza_interrupcoes(self);
+      break;
+    case 5: // interrupção da tela
+      self->int_tela = (valor != 0);
+      terminal_atualiza_interrupcoes(self);
+      break;
     default:
       return ERR_DISP_INV;
   }
@@ -11,11 +11,23 @@
 // mantém o conteúdo da linha de saída de um terminal (o que aparece na tela) e
 // da linha de entrada (o que foi digitado e ainda não foi lido pela CPU)
 //
-// implementa 4 dispositivos associados a um terminal:
+// implementa 6 dispositivos associados a um terminal:
 // - leitura do próximo caractere de entrada
 // - leitura do estado da entrada (se tem caractere disponível ou não)
 // - escrita de um caractere na saída
 // - leitura do estado da saída (se um caractere pode ser escrito ou não)
+// - interrupção do teclado: escrita habilita (1) ou desabilita (0); leitura
+//   diz se a interrupção está sendo pedida (habilitada e com caractere
+//   disponível na entrada)
+// - interrupção da tela: escrita habilita (1) ou desabilita (0); leitura diz
+//   se a interrupção está sendo pedida (habilitada e a saída pode receber um
+//   caractere)
+//
+// as interrupções começam desabilitadas. o pedido de interrupção permanece
+//   enquanto a condição for verdadeira; quem trata a interrupção deve
+//   consumir o caractere, escrever na saída ou desabilitar a interrupção.
+//   os pedidos são informados ao controlador de interrupções definido com
+//   terminal_define_pic.
 //
 // a leitura não é possível quando não existir caractere na entrada
 // existe um limite para caracteres digitados e não lidos; caracteres adicionais
@@ -24,7 +36,8 @@
 //   adicional causa a "rolagem", que remove o primeiro caractere da linha para
 //   gerar espaço para o novo. a impressão de um \n causa a "limpeza" da linha.
 // a escrita não é possível se a saída estiver rolando ou sendo limpa, o que é
-//   feito um caractere por vez (a cada chamada a tictac).
+//   feito um caractere por unidade de tempo, com eventos programados na
+//   agenda do terminal.
 //
 // a E/S efetiva é realizada pela console. ela obtém acesso às linhas de entrada e
 //   saída chamando terminal_txt_entrada ou terminal_txt_saida. a console insere
@@ -32,15 +45,24 @@
 //   linha de saída com terminal_limpa_saida.
 
 #include <stdbool.h>
+#include <stdio.h>
 #include "es.h"
+#include "pic.h"
+#include "agenda.h"
 
 typedef struct terminal_t terminal_t;
 
 // aloca e inicializa um novo terminal
-terminal_t *terminal_cria(int tam_linha);
+// a rolagem e a limpeza da saída são feitas com eventos em 'agenda'
+terminal_t *terminal_cria(int tam_linha, agenda_t *agenda);
 // libera a memória ocupada por um terminal
 void terminal_destroi(terminal_t *self);
 
+// define o controlador de interrupções avisado quando o terminal passa a
+//   pedir (e deixa de pedir) as interrupções do teclado e da tela
+void terminal_define_pic(terminal_t *self, pic_t *pic, irq_t irq_teclado,
+                         irq_t irq_tela);
+
 // retorna a linha de entrada do terminal (para uso pela console)
 char *terminal_txt_entrada(terminal_t *self);
 
@@ -51,12 +73,16 @@ char *terminal_txt_saida(terminal_t *self);
 // (para uso pela console, para simular um caractere digitado no teclado)
 void terminal_insere_char(terminal_t *self, char ch);
 
+// retorna true se a entrada do terminal não comporta mais caracteres
+bool terminal_entrada_cheia(terminal_t *self);
+
+// define um arquivo onde será copiado cada caractere impresso na saída do
+//   terminal (para uso pela console, quando não tem tela); NULL para não copiar
+void terminal_define_arquivo_saida(terminal_t *self, FILE *arq);
+
 // limpa a linha de saída (para uso pela console)
 void terminal_limpa_saida(terminal_t *self);
 
-// esta função deve ser chamada periodicamente
-void terminal_tictac(terminal_t *self);
-
 // Funções para implementar o protocolo de acesso a um dispositivo pelo
 //   controlador de E/S
 // Devem seguir o protocolo f_leitura_t e f_escrita_t declarados em es.h